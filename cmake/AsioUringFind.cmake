@@ -1,2 +1,3 @@
 find_package(Boost 1.70.0 REQUIRED system)
+find_package(Threads REQUIRED)
 find_package(Uring REQUIRED)
@@ -32,4 +32,20 @@ accept_file::service_type& accept_file::get_service() noexcept {
   return impl_->get_service();
 }
 
+void accept_file::cancel() {
+  assert(impl_);
+  impl_->cancel();
+}
+
+void accept_file::impl::cancel() {
+  cancelled_ = true;
+  poll_file::cancel();
+}
+
+void accept_file::impl::recheck() {
+  if (cancelled_) {
+    poll_file::cancel();
+  }
+}
+
 }
@@ -0,0 +1 @@
+#include <asio_uring/asio/basic_waitable_timer.hpp>
@@ -0,0 +1 @@
+#include <asio_uring/asio/datagram_file.hpp>
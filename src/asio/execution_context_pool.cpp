@@ -0,0 +1 @@
+#include <asio_uring/asio/execution_context_pool.hpp>
@@ -2,15 +2,64 @@
 
 #include <cassert>
 #include <memory>
+#include <utility>
+#include <asio_uring/asio/execution_context.hpp>
+#include <asio_uring/asio/service.hpp>
 #include <asio_uring/fd.hpp>
+#include <boost/system/error_code.hpp>
 
 namespace asio_uring::asio {
 
+namespace {
+
+class registered_fd {
+public:
+  registered_fd() = delete;
+  registered_fd(const registered_fd&) = delete;
+  registered_fd(registered_fd&&) = delete;
+  registered_fd& operator=(const registered_fd&) = delete;
+  registered_fd& operator=(registered_fd&&) = delete;
+  registered_fd(execution_context& ctx,
+                fd f)
+    : file  (std::move(f)),
+      ctx_  (ctx),
+      index_(ctx.register_file(file.native_handle()))
+  {}
+  ~registered_fd() noexcept {
+    try {
+      ctx_.unregister_file(index_);
+    } catch (...) {}
+  }
+  int index() const noexcept {
+    return index_;
+  }
+  fd file;
+private:
+  execution_context& ctx_;
+  int                index_;
+};
+
+}
+
 file_object::file_object(execution_context& ctx,
-                         fd file)
-  : base(ctx),
-    fd_ (std::make_shared<fd>(std::move(file)))
-{}
+                         fd file,
+                         bool fixed)
+  : base  (ctx),
+    index_(-1)
+{
+  if (!fixed) {
+    fd_ = std::make_shared<fd>(std::move(file));
+    return;
+  }
+  //  The slot lives exactly as long as the file
+  //  descriptor since operations in flight refer
+  //  to it by index
+  auto ptr = std::make_shared<registered_fd>(ctx,
+                                             std::move(file));
+  index_ = ptr->index();
+  fd_ = std::shared_ptr<fd>(ptr,
+                            &ptr->file);
+}
 
 file_object::native_handle_type file_object::native_handle() noexcept {
   assert(fd_);
@@ -22,6 +71,23 @@ file_object::const_native_handle_type file_object::native_handle() const noexcep
   return fd_->native_handle();
 }
 
+bool file_object::fixed() const noexcept {
+  return index_ != -1;
+}
+
+service::file file_object::file_handle() const noexcept {
+  assert(fd_);
+  if (fixed()) {
+    return service::file(index_,
+                         true);
+  }
+  return service::file(fd_->native_handle());
+}
+
+void file_object::cancel() {
+  get_service().initiate_cancel(get_implementation());
+}
+
 void file_object::reset() noexcept {
   fd_.reset();
 }
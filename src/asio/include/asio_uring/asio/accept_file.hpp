@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <memory>
 #include <optional>
@@ -11,9 +12,11 @@
 #include <utility>
 #include <asio_uring/accept.hpp>
 #include <asio_uring/fd.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/system/error_code.hpp>
 #include "error_code.hpp"
 #include "poll_file.hpp"
+#include <errno.h>
 
 namespace asio_uring::asio {
 
@@ -94,6 +97,88 @@ private:
                              accept_file::signature>(std::move(i),
                                                      std::forward<CompletionToken>(token));
     }
+    template<typename Handler>
+    void async_accept_multishot(Handler h) {
+      cancelled_ = false;
+      arm(std::move(h),
+          true);
+      recheck();
+    }
+    void cancel();
+  private:
+    template<typename Handler>
+    void arm(Handler h,
+             bool multishot)
+    {
+      if (!multishot) {
+        char* ptr = nullptr;
+        async_accept(ptr,
+                     [self = shared_from_this(),
+                      h = std::move(h)](boost::system::error_code ec,
+                                        fd accepted) mutable
+                     {
+                       if (ec) {
+                         h(ec,
+                           fd());
+                         return;
+                       }
+                       h(ec,
+                         std::move(accepted));
+                       self->rearm(std::move(h),
+                                   false);
+                     });
+        return;
+      }
+      get_service().initiate_accept_multishot(get_implementation(),
+                                              file_handle(),
+                                              [self = shared_from_this(),
+                                               h = std::move(h),
+                                               delivered = false](boost::system::error_code ec,
+                                                                  fd accepted,
+                                                                  bool more) mutable
+                                              {
+                                                if (ec) {
+                                                  //  Kernels which predate multishot accept
+                                                  //  reject it before accepting anything
+                                                  //  (the stream may have been cancelled
+                                                  //  in the meantime)
+                                                  if (!delivered && (ec.value() == EINVAL)) {
+                                                    self->rearm(std::move(h),
+                                                                false);
+                                                  } else if (!more) {
+                                                    h(ec,
+                                                      fd());
+                                                  }
+                                                  return;
+                                                }
+                                                delivered = true;
+                                                h(ec,
+                                                  std::move(accepted));
+                                                if (!more) {
+                                                  self->rearm(std::move(h),
+                                                              true);
+                                                }
+                                              });
+    }
+    template<typename Handler>
+    void rearm(Handler h,
+               bool multishot)
+    {
+      if (cancelled_) {
+        h(make_error_code(boost::asio::error::operation_aborted),
+          fd());
+        return;
+      }
+      arm(std::move(h),
+          multishot);
+      recheck();
+    }
+    void recheck();
+    //  Set by cancel (possibly on another thread) before it
+    //  gathers the outstanding operations and checked by
+    //  rearm after it initiates the next one so that one
+    //  or the other observes the newly-armed operation
+    std::atomic<bool> cancelled_{false};
   };
 public:
   /**
@@ -215,6 +300,63 @@ public:
     return impl_->async_accept(std::addressof(addr),
                                std::forward<CompletionToken>(token));
   }
+  /**
+   *  Begins accepting connections continuously and
+   *  delivers each one to a persistent handler.
+   *
+   *  A single `IORING_OP_ACCEPT` with
+   *  `IORING_ACCEPT_MULTISHOT` is submitted which
+   *  yields a completion for every connection accepted
+   *  rather than one operation (and one completion
+   *  object) being initiated per connection. If the
+   *  kernel ends the stream the operation is rearmed
+   *  transparently. On kernels which do not support
+   *  multishot accept connections are accepted one at
+   *  a time as by \ref async_accept.
+   *
+   *  Accepted file descriptors have `O_NONBLOCK` set.
+   *  To use them via the registered file table pass
+   *  them to an I/O object with `fixed` set (e.g.
+   *  \ref poll_file).
+   *
+   *  Unlike a completion handler the handler is
+   *  invoked directly on a thread running the
+   *  associated \ref execution_context (its associated
+   *  executor, if any, is not used) and the execution
+   *  context does not run out of work until the stream
+   *  ends.
+   *
+   *  \tparam Handler
+   *    A function object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         fd);
+   *    \endcode
+   *    Which is invoked with a falsy error code and the
+   *    accepted file descriptor for each connection. The
+   *    stream ends with a single invocation with a
+   *    truthy error code (`boost::asio::error::operation_aborted`
+   *    after \ref cancel) after which the handler is
+   *    not invoked again.
+   *
+   *  \param [in] h
+   *    The handler.
+   */
+  template<typename Handler>
+  void async_accept_multishot(Handler h) {
+    assert(impl_);
+    impl_->async_accept_multishot(std::move(h));
+  }
+  /**
+   *  Requests cancellation of all outstanding
+   *  operations (including a stream begun by
+   *  \ref async_accept_multishot).
+   *
+   *  Cancelled operations complete with
+   *  `boost::asio::error::operation_aborted`.
+   */
+  void cancel();
 private:
   using impl_type = std::shared_ptr<impl>;
   impl_type impl_;
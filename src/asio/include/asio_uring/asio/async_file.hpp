@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <utility>
+#include <boost/asio/buffer.hpp>
 #include "file_object.hpp"
 
 namespace asio_uring::asio {
@@ -17,6 +18,8 @@ namespace asio_uring::asio {
  *
  *  - `IORING_OP_READV`
  *  - `IORING_OP_WRITEV`
+ *  - `IORING_OP_READ_FIXED`
+ *  - `IORING_OP_WRITE_FIXED`
  *  - `IORING_OP_FSYNC`
  *
  *  Note that this describes file descriptors to
@@ -81,7 +84,7 @@ public:
                           CompletionToken&& token)
   {
     return get_service().initiate_read_some_at(get_implementation(),
-                                               native_handle(),
+                                               file_handle(),
                                                o,
                                                mb,
                                                wrap_token(std::forward<CompletionToken>(token)));
@@ -127,11 +130,103 @@ public:
                            CompletionToken&& token)
   {
     return get_service().initiate_write_some_at(get_implementation(),
-                                                native_handle(),
+                                                file_handle(),
                                                 o,
                                                 cb,
                                                 wrap_token(std::forward<CompletionToken>(token)));
   }
+  /**
+   *  Initiates an asynchronous read at a certain offset
+   *  into a buffer registered with the execution context
+   *  (see \ref asio_uring::execution_context::register_buffers
+   *  "execution_context::register_buffers").
+   *
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the arguments are:
+   *    1. The result of the operation
+   *    2. The number of bytes read
+   *
+   *  \param [in] o
+   *    The offset from the beginning of the file at which
+   *    to perform the read.
+   *  \param [in] mb
+   *    The buffer into which to read. Must lie entirely
+   *    within the registered buffer with index `buf_index`.
+   *  \param [in] buf_index
+   *    The index of the registered buffer.
+   *  \param [in] token
+   *    The completion token which shall be used to notify the
+   *    caller of completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename CompletionToken>
+  auto async_read_some_at_fixed(std::uint64_t o,
+                                boost::asio::mutable_buffer mb,
+                                int buf_index,
+                                CompletionToken&& token)
+  {
+    return get_service().initiate_read_some_at_fixed(get_implementation(),
+                                                     file_handle(),
+                                                     o,
+                                                     mb,
+                                                     buf_index,
+                                                     wrap_token(std::forward<CompletionToken>(token)));
+  }
+  /**
+   *  Initiates an asynchronous write at a certain offset
+   *  from a buffer registered with the execution context
+   *  (see \ref asio_uring::execution_context::register_buffers
+   *  "execution_context::register_buffers").
+   *
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the arguments are:
+   *    1. The result of the operation
+   *    2. The number of bytes written
+   *
+   *  \param [in] o
+   *    The offset from the beginning of the file at which
+   *    to perform the write.
+   *  \param [in] cb
+   *    The buffer from which to write. Must lie entirely
+   *    within the registered buffer with index `buf_index`.
+   *  \param [in] buf_index
+   *    The index of the registered buffer.
+   *  \param [in] token
+   *    The completion token which shall be used to notify the
+   *    caller of completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename CompletionToken>
+  auto async_write_some_at_fixed(std::uint64_t o,
+                                 boost::asio::const_buffer cb,
+                                 int buf_index,
+                                 CompletionToken&& token)
+  {
+    return get_service().initiate_write_some_at_fixed(get_implementation(),
+                                                      file_handle(),
+                                                      o,
+                                                      cb,
+                                                      buf_index,
+                                                      wrap_token(std::forward<CompletionToken>(token)));
+  }
   /**
    *  Asynchronously performs `fsync` or `fdatasync` against
    *  the managed file descriptor.
@@ -160,7 +255,7 @@ public:
                    CompletionToken&& token)
   {
     return get_service().initiate_fsync(get_implementation(),
-                                        native_handle(),
+                                        file_handle(),
                                         data_only,
                                         wrap_token(std::forward<CompletionToken>(token)));
   }
@@ -0,0 +1,262 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <asio_uring/liburing.hpp>
+#include <boost/asio/wait_traits.hpp>
+#include "execution_context.hpp"
+#include "timer_object.hpp"
+
+namespace asio_uring::asio {
+
+/**
+ *  A timer which waits via `IORING_OP_TIMEOUT` and
+ *  therefore requires no event loop other than the
+ *  associated \ref execution_context.
+ *
+ *  This class models `WaitableTimer`.
+ *
+ *  When `Clock` is `std::chrono::steady_clock` or
+ *  `std::chrono::system_clock` waits are absolute
+ *  (against `CLOCK_MONOTONIC` and `CLOCK_REALTIME`
+ *  respectively, the latter requiring Linux 5.15 or
+ *  later) so that the time which passes between
+ *  initiation and submission does not delay expiry
+ *  (and so that waits on a \ref system_timer honor
+ *  changes to the system clock). Otherwise waits are
+ *  relative as determined by `WaitTraits` at
+ *  initiation.
+ *
+ *  \tparam Clock
+ *    A type which models `TrivialClock`.
+ *  \tparam WaitTraits
+ *    A type which models `WaitTraits`. Defaults to
+ *    `boost::asio::wait_traits<Clock>`.
+ */
+template<typename Clock,
+         typename WaitTraits = boost::asio::wait_traits<Clock>>
+class basic_waitable_timer : public timer_object {
+public:
+  /**
+   *  The clock type.
+   */
+  using clock_type = Clock;
+  /**
+   *  The duration type of the clock.
+   */
+  using duration = typename clock_type::duration;
+  /**
+   *  The time point type of the clock.
+   */
+  using time_point = typename clock_type::time_point;
+  /**
+   *  The wait traits type.
+   */
+  using traits_type = WaitTraits;
+  /**
+   *  Creates a timer which expires at the epoch of the
+   *  clock (i.e. which has already expired).
+   *
+   *  \param [in] ctx
+   *    The \ref execution_context "execution context". This
+   *    reference must remain valid until the end of this
+   *    object's lifetime or the behavior is undefined.
+   */
+  explicit basic_waitable_timer(execution_context& ctx)
+    : timer_object(ctx),
+      expiry_     ()
+  {}
+  /**
+   *  Creates a timer which expires at a certain time.
+   *
+   *  \param [in] ctx
+   *    The \ref execution_context "execution context". This
+   *    reference must remain valid until the end of this
+   *    object's lifetime or the behavior is undefined.
+   *  \param [in] t
+   *    The time at which the timer expires.
+   */
+  basic_waitable_timer(execution_context& ctx,
+                       const time_point& t)
+    : timer_object(ctx),
+      expiry_     (t)
+  {}
+  /**
+   *  Creates a timer which expires after a certain
+   *  duration.
+   *
+   *  \param [in] ctx
+   *    The \ref execution_context "execution context". This
+   *    reference must remain valid until the end of this
+   *    object's lifetime or the behavior is undefined.
+   *  \param [in] d
+   *    The duration after which the timer expires.
+   */
+  basic_waitable_timer(execution_context& ctx,
+                       const duration& d)
+    : timer_object(ctx),
+      expiry_     (clock_type::now() + d)
+  {}
+  /**
+   *  Obtains the time at which the timer expires.
+   *
+   *  \return
+   *    The time point.
+   */
+  time_point expiry() const {
+    return expiry_;
+  }
+  /**
+   *  Sets the time at which the timer expires and
+   *  cancels all pending waits (see \ref cancel).
+   *
+   *  \param [in] t
+   *    The time point.
+   *
+   *  \return
+   *    As for \ref cancel.
+   */
+  std::size_t expires_at(const time_point& t) {
+    auto retr = cancel();
+    expiry_ = t;
+    return retr;
+  }
+  /**
+   *  Sets the time at which the timer expires relative
+   *  to now and cancels all pending waits (see
+   *  \ref cancel).
+   *
+   *  \param [in] d
+   *    The duration.
+   *
+   *  \return
+   *    As for \ref cancel.
+   */
+  std::size_t expires_after(const duration& d) {
+    return expires_at(clock_type::now() + d);
+  }
+  /**
+   *  Sets the time at which the timer expires and
+   *  moves all pending waits to that time in place
+   *  (`IORING_TIMEOUT_UPDATE`) rather than cancelling
+   *  them. Requires Linux 5.11 or later.
+   *
+   *  This is the cheaper way to push back an idle
+   *  timeout each time there is activity.
+   *
+   *  \param [in] t
+   *    The time point.
+   *
+   *  \return
+   *    As for \ref timer_object::update "update".
+   */
+  std::size_t reschedule_at(const time_point& t) {
+    expiry_ = t;
+    auto [ns, flags] = to_wait(t);
+    return update(ns,
+                  flags & IORING_TIMEOUT_ABS);
+  }
+  /**
+   *  Equivalent to calling \ref reschedule_at with
+   *  the current time plus a certain duration.
+   *
+   *  \param [in] d
+   *    The duration.
+   *
+   *  \return
+   *    As for \ref timer_object::update "update".
+   */
+  std::size_t reschedule_after(const duration& d) {
+    return reschedule_at(clock_type::now() + d);
+  }
+  /**
+   *  Blocks the calling thread until the timer
+   *  expires.
+   */
+  void wait() {
+    for (auto now = clock_type::now(); now < expiry_; now = clock_type::now()) {
+      std::this_thread::sleep_for(traits_type::to_wait_duration(expiry_ - now));
+    }
+  }
+  /**
+   *  Initiates an asynchronous wait for the timer to
+   *  expire.
+   *
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion
+   *    handler is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code);
+   *    \endcode
+   *    Where the argument is the result of the operation:
+   *    Falsy once the timer expires or
+   *    `boost::asio::error::operation_aborted` if the
+   *    wait was cancelled.
+   *
+   *  \param [in] token
+   *    The completion token to use to notify the caller
+   *    of completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken`
+   *    and `token`.
+   */
+  template<typename CompletionToken>
+  auto async_wait(CompletionToken&& token) {
+    auto [ns, flags] = to_wait(expiry_);
+    return async_wait_for(ns,
+                          flags,
+                          std::forward<CompletionToken>(token));
+  }
+private:
+  static std::pair<std::chrono::nanoseconds,
+                   unsigned> to_wait(const time_point& t)
+  {
+    if constexpr (std::is_same_v<clock_type,
+                                 std::chrono::steady_clock>)
+    {
+      return {std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()),
+              IORING_TIMEOUT_ABS};
+    } else if constexpr (std::is_same_v<clock_type,
+                                        std::chrono::system_clock>)
+    {
+      return {std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()),
+              IORING_TIMEOUT_ABS | IORING_TIMEOUT_REALTIME};
+    } else {
+      //  The time point overload of to_wait_duration
+      //  in Boost.Asio overflows for clocks the epoch of
+      //  which is not far in the past
+      auto d = traits_type::to_wait_duration(t - clock_type::now());
+      if (d <= duration::zero()) {
+        return {std::chrono::nanoseconds::zero(),
+                0};
+      }
+      if (d >= std::chrono::duration_cast<duration>(std::chrono::nanoseconds::max())) {
+        return {std::chrono::nanoseconds::max(),
+                0};
+      }
+      return {std::chrono::duration_cast<std::chrono::nanoseconds>(d),
+              0};
+    }
+  }
+  time_point expiry_;
+};
+
+/**
+ *  A \ref basic_waitable_timer for `std::chrono::steady_clock`.
+ */
+using steady_timer = basic_waitable_timer<std::chrono::steady_clock>;
+
+/**
+ *  A \ref basic_waitable_timer for `std::chrono::system_clock`.
+ */
+using system_timer = basic_waitable_timer<std::chrono::system_clock>;
+
+}
@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <memory>
+#include <type_traits>
 #include <utility>
 #include <boost/asio/associated_allocator.hpp>
 #include <boost/asio/associated_executor.hpp>
@@ -151,6 +152,18 @@ public:
   template<typename... Args>
   void operator()(Args&&... args) {
     auto g = std::move(work_);
+    //  This is what dispatch would do but without
+    //  binding the arguments into a temporary function
+    //  object
+    if constexpr (std::is_same_v<executor_type,
+                                 execution_context::executor_type>)
+    {
+      if (g.get_executor().context().running_in_this_thread()) {
+        auto h = std::move(h_);
+        h(std::forward<Args>(args)...);
+        return;
+      }
+    }
     g.get_executor().dispatch(std::bind(std::move(h_),
                                         std::forward<Args>(args)...),
                               alloc_);
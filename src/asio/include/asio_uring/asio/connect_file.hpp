@@ -4,11 +4,20 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <system_error>
+#include <type_traits>
 #include <utility>
 #include <asio_uring/connect.hpp>
+#include <asio_uring/liburing.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
 #include "error_code.hpp"
 #include "poll_file.hpp"
+#include <sys/poll.h>
+#include <sys/socket.h>
 
 namespace asio_uring::asio {
 
@@ -16,10 +25,74 @@ namespace asio_uring::asio {
  *  An I/O object for file descriptors for which
  *  the `connect` POSIX function is valid and/or
  *  meaningful.
+ *
+ *  When \ref native "native" and the kernel supports
+ *  it \ref async_connect submits `IORING_OP_CONNECT`
+ *  so that the connection attempt requires no system
+ *  calls beyond the submission. Otherwise it performs
+ *  a non-blocking `connect`, waits for the file
+ *  descriptor to become writable, and retrieves the
+ *  result with `getsockopt`.
  */
 class connect_file : public poll_file {
 private:
-  using signature = void(std::error_code);
+  using signature = void(boost::system::error_code);
+  template<typename Address,
+           typename CompletionToken>
+  auto async_connect_impl(const Address& addr,
+                          std::optional<std::chrono::nanoseconds> timeout,
+                          CompletionToken&& token)
+  {
+    static_assert(sizeof(Address) <= sizeof(::sockaddr_storage));
+    if (native() && get_service().context().opcode_supported(IORING_OP_CONNECT)) {
+      return get_service().initiate_connect(get_implementation(),
+                                            file_handle(),
+                                            reinterpret_cast<const ::sockaddr*>(std::addressof(addr)),
+                                            sizeof(addr),
+                                            timeout,
+                                            wrap_token(std::forward<CompletionToken>(token)));
+    }
+    std::error_code ec;
+    bool connected = asio_uring::connect(native_handle(),
+                                         addr,
+                                         ec);
+    if (ec) {
+      return post(std::forward<CompletionToken>(token),
+                  to_boost_error_code(ec));
+    }
+    if (connected) {
+      return post(std::forward<CompletionToken>(token),
+                  boost::system::error_code());
+    }
+    auto i = [fd = native_handle()](boost::system::error_code ec,
+                                    auto h)
+    {
+      if (!ec) {
+        auto sec = connect_error(fd);
+        if (sec) {
+          ec = to_boost_error_code(sec);
+        }
+      }
+      h(ec);
+    };
+    if (!timeout) {
+      return async_poll_then<false,
+                             signature>(i,
+                                        std::forward<CompletionToken>(token));
+    }
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    get_service().initiate_poll_add(get_implementation(),
+                                    file_handle(),
+                                    POLLOUT,
+                                    timeout,
+                                    wrap_token(detail::poll_file_op(std::move(i),
+                                                                    std::move(h))));
+    return result.get();
+  }
 public:
   using poll_file::poll_file;
   /**
@@ -39,6 +112,8 @@ public:
    *
    *  \param [in] addr
    *    The object which represents the destination address.
+   *    This object is copied as needed and need not remain
+   *    valid after this function returns.
    *  \param [in] token
    *    A completion token which shall be used to notify the
    *    caller of completion.
@@ -52,32 +127,64 @@ public:
   auto async_connect(const Address& addr,
                      CompletionToken&& token)
   {
-    std::error_code ec;
-    bool connected = asio_uring::connect(native_handle(),
-                                         addr,
-                                         ec);
-    if (ec) {
-      return post(std::forward<CompletionToken>(token),
-                  to_boost_error_code(ec));
-    }
-    if (connected) {
-      return post(std::forward<CompletionToken>(token),
-                  boost::system::error_code());
-    }
-    auto i = [fd = native_handle()](boost::system::error_code ec,
-                                    auto h)
-    {
-      if (!ec) {
-        auto sec = connect_error(fd);
-        if (sec) {
-          ec = to_boost_error_code(sec);
-        }
-      }
-      h(ec);
-    };
-    return async_poll_then<false,
-                           signature>(i,
-                                      std::forward<CompletionToken>(token));
+    return async_connect_impl(addr,
+                              std::nullopt,
+                              std::forward<CompletionToken>(token));
+  }
+  /**
+   *  Initiates an asynchronous connection attempt which
+   *  is abandoned if it does not complete within a
+   *  certain time.
+   *
+   *  The timeout is linked to the operation in the
+   *  `io_uring` (`IORING_OP_LINK_TIMEOUT`) so that no
+   *  separate timer is required.
+   *
+   *  \tparam Address
+   *    The type of object used to represent the
+   *    destination address.
+   *  \tparam Rep
+   *    The arithmetic type which represents the number
+   *    of ticks in the timeout.
+   *  \tparam Period
+   *    A `std::ratio` which represents the tick period
+   *    of the timeout.
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion
+   *    handler is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code);
+   *    \endcode
+   *    Where the sole argument gives the result of the
+   *    operation which is `boost::asio::error::timed_out`
+   *    if the timeout elapsed.
+   *
+   *  \param [in] addr
+   *    The object which represents the destination address.
+   *    This object is copied as needed and need not remain
+   *    valid after this function returns.
+   *  \param [in] timeout
+   *    The timeout.
+   *  \param [in] token
+   *    A completion token which shall be used to notify the
+   *    caller of completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename Address,
+           typename Rep,
+           typename Period,
+           typename CompletionToken>
+  auto async_connect(const Address& addr,
+                     std::chrono::duration<Rep,
+                                           Period> timeout,
+                     CompletionToken&& token)
+  {
+    return async_connect_impl(addr,
+                              std::chrono::duration_cast<std::chrono::nanoseconds>(timeout),
+                              std::forward<CompletionToken>(token));
   }
 };
 
@@ -0,0 +1,442 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <asio_uring/buffer_ring.hpp>
+#include <asio_uring/liburing.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+#include "file_object.hpp"
+#include <sys/socket.h>
+
+namespace asio_uring::asio {
+
+/**
+ *  A datagram to send as part of a batch (see
+ *  \ref datagram_file::async_send_to_batch).
+ *
+ *  \tparam Address
+ *    The type of socket address (e.g. `::sockaddr_in`).
+ */
+template<typename Address>
+class outgoing_datagram {
+public:
+  outgoing_datagram() = delete;
+  /**
+   *  Creates an outgoing datagram.
+   *
+   *  \param [in] buffer
+   *    The payload. The underlying storage must remain
+   *    valid until the batch completes or the behavior
+   *    is undefined.
+   *  \param [in] destination
+   *    The address to which to send the payload. This
+   *    is copied.
+   */
+  outgoing_datagram(boost::asio::const_buffer buffer,
+                    const Address& destination) noexcept
+    : buffer_     (buffer),
+      destination_(destination)
+  {}
+  /**
+   *  Obtains the payload.
+   *
+   *  \return
+   *    A buffer.
+   */
+  boost::asio::const_buffer buffer() const noexcept {
+    return buffer_;
+  }
+  /**
+   *  Obtains the address to which the payload shall
+   *  be sent.
+   *
+   *  \return
+   *    A reference to the address.
+   */
+  const Address& destination() const noexcept {
+    return destination_;
+  }
+private:
+  boost::asio::const_buffer buffer_;
+  Address                   destination_;
+};
+
+/**
+ *  A datagram received into a buffer selected from
+ *  a \ref buffer_ring (see
+ *  \ref datagram_file::async_receive_from_multishot).
+ *
+ *  Owns the \ref buffer_ring::lease "lease" on that
+ *  buffer which is returned to the ring when this
+ *  object is released or destroyed.
+ *
+ *  \tparam Address
+ *    The type of socket address (e.g. `::sockaddr_in`).
+ */
+template<typename Address>
+class received_datagram {
+public:
+  /**
+   *  Creates a received datagram which owns no
+   *  buffer.
+   */
+  received_datagram() noexcept
+    : sender_   {},
+      size_     (0),
+      truncated_(false)
+  {}
+  /**
+   *  Creates a received datagram by parsing a buffer
+   *  filled by a multishot `IORING_OP_RECVMSG` whose
+   *  message header reserved `sizeof(Address)` bytes
+   *  for the name and none for control data.
+   *
+   *  \param [in] l
+   *    The lease on the buffer.
+   */
+  explicit received_datagram(buffer_ring::lease l) noexcept
+    : received_datagram()
+  {
+    ::io_uring_recvmsg_out out;
+    constexpr std::size_t header = sizeof(out) + sizeof(Address);
+    if (l.size() < header) {
+      return;
+    }
+    auto ptr = static_cast<const unsigned char*>(l.data());
+    std::memcpy(&out,
+                ptr,
+                sizeof(out));
+    std::memcpy(&sender_,
+                ptr + sizeof(out),
+                std::min<std::size_t>(out.namelen,
+                                      sizeof(Address)));
+    size_ = std::min<std::size_t>(out.payloadlen,
+                                  l.size() - header);
+    truncated_ = out.flags & MSG_TRUNC;
+    lease_ = std::move(l);
+  }
+  /**
+   *  Obtains the address from which the datagram was
+   *  sent.
+   *
+   *  \return
+   *    A reference to the address.
+   */
+  const Address& sender() const noexcept {
+    return sender_;
+  }
+  /**
+   *  Obtains the payload.
+   *
+   *  \return
+   *    A buffer which is empty if this object owns no
+   *    buffer.
+   */
+  boost::asio::const_buffer data() const noexcept {
+    if (!lease_) {
+      return boost::asio::const_buffer();
+    }
+    return boost::asio::const_buffer(static_cast<const unsigned char*>(lease_.data()) +
+                                     sizeof(::io_uring_recvmsg_out) +
+                                     sizeof(Address),
+                                     size_);
+  }
+  /**
+   *  Determines whether the datagram was larger than
+   *  the space remaining in the buffer and therefore
+   *  only a prefix thereof was received.
+   *
+   *  \return
+   *    `true` if so, `false` otherwise.
+   */
+  bool truncated() const noexcept {
+    return truncated_;
+  }
+  /**
+   *  Determines whether this object owns a buffer.
+   *
+   *  \return
+   *    `true` if so, `false` otherwise.
+   */
+  explicit operator bool() const noexcept {
+    return bool(lease_);
+  }
+  /**
+   *  Returns the owned buffer (if any) to the ring.
+   */
+  void release() noexcept {
+    lease_.release();
+  }
+private:
+  buffer_ring::lease lease_;
+  Address            sender_;
+  std::size_t        size_;
+  bool               truncated_;
+};
+
+/**
+ *  An I/O object for datagram sockets which sends and
+ *  receives via `IORING_OP_SENDMSG` and
+ *  `IORING_OP_RECVMSG` and therefore never waits for
+ *  readiness itself.
+ *
+ *  In addition to operations on single datagrams
+ *  many datagrams may be sent with a single entry into
+ *  the kernel (see \ref async_send_to_batch) and
+ *  datagrams may be received continuously into buffers
+ *  selected from a \ref buffer_ring (see
+ *  \ref async_receive_from_multishot).
+ *
+ *  Addresses are represented by socket address
+ *  structures (e.g. `::sockaddr_in`) whose size is
+ *  used as the address length.
+ *
+ *  \sa
+ *    poll_file
+ */
+class datagram_file : public file_object {
+public:
+  using file_object::file_object;
+  /**
+   *  Asynchronously sends a datagram.
+   *
+   *  \tparam ConstBufferSequence
+   *    A type which models `ConstBufferSequence`.
+   *  \tparam Address
+   *    The type of socket address.
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the first argument is the result of the
+   *    operation and the second argument is the number
+   *    of bytes sent.
+   *
+   *  \param [in] cb
+   *    The buffers which together form the payload. The
+   *    underlying buffers must remain valid until the
+   *    completion handler is invoked or the behavior is
+   *    undefined.
+   *  \param [in] destination
+   *    The address to which to send the datagram. This
+   *    is copied.
+   *  \param [in] token
+   *    A completion token to use to notify the caller of
+   *    completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename ConstBufferSequence,
+           typename Address,
+           typename CompletionToken>
+  auto async_send_to(ConstBufferSequence cb,
+                     const Address& destination,
+                     CompletionToken&& token)
+  {
+    return get_service().initiate_sendmsg(get_implementation(),
+                                          file_handle(),
+                                          cb,
+                                          reinterpret_cast<const ::sockaddr*>(std::addressof(destination)),
+                                          sizeof(destination),
+                                          MSG_NOSIGNAL,
+                                          wrap_token(std::forward<CompletionToken>(token)));
+  }
+  /**
+   *  Asynchronously receives a datagram.
+   *
+   *  \tparam MutableBufferSequence
+   *    A type which models `MutableBufferSequence`.
+   *  \tparam Address
+   *    The type of socket address.
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the first argument is the result of the
+   *    operation and the second argument is the number
+   *    of bytes received (any remainder of a datagram
+   *    which does not fit in `mb` is discarded).
+   *
+   *  \param [in] mb
+   *    The buffers into which to receive. The underlying
+   *    buffers must remain valid until the completion
+   *    handler is invoked or the behavior is undefined.
+   *  \param [out] sender
+   *    The address into which to write the address from
+   *    which the datagram was sent. Must remain valid
+   *    until the completion handler is invoked or the
+   *    behavior is undefined.
+   *  \param [in] token
+   *    A completion token to use to notify the caller of
+   *    completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename MutableBufferSequence,
+           typename Address,
+           typename CompletionToken>
+  auto async_receive_from(MutableBufferSequence mb,
+                          Address& sender,
+                          CompletionToken&& token)
+  {
+    return get_service().initiate_recvmsg(get_implementation(),
+                                          file_handle(),
+                                          mb,
+                                          reinterpret_cast<::sockaddr*>(std::addressof(sender)),
+                                          sizeof(sender),
+                                          0,
+                                          wrap_token(std::forward<CompletionToken>(token)));
+  }
+  /**
+   *  Asynchronously sends many datagrams.
+   *
+   *  An `IORING_OP_SENDMSG` is prepared for each
+   *  datagram and all of them are submitted together
+   *  (see \ref asio_uring::execution_context::submission_batch "submission_batch")
+   *  so that the cost of entering the kernel is shared
+   *  among them. The datagrams are sent independently
+   *  and therefore not necessarily in order.
+   *
+   *  \tparam DatagramRange
+   *    A type whose elements are \ref outgoing_datagram
+   *    objects (or objects with equivalent `buffer` and
+   *    `destination` member functions) and which may be
+   *    iterated more than once.
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Which is invoked once all datagrams have been
+   *    sent or have failed. The first argument is the
+   *    first failure (if any) and the second argument
+   *    is the number of datagrams sent.
+   *
+   *  \param [in] datagrams
+   *    The datagrams. Addresses and buffers are copied
+   *    before this function returns however the storage
+   *    underlying the buffers must remain valid until
+   *    the completion handler is invoked or the behavior
+   *    is undefined.
+   *  \param [in] token
+   *    A completion token to use to notify the caller of
+   *    completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename DatagramRange,
+           typename CompletionToken>
+  auto async_send_to_batch(const DatagramRange& datagrams,
+                           CompletionToken&& token)
+  {
+    using std::begin;
+    using std::end;
+    return get_service().initiate_sendmsg_batch(get_implementation(),
+                                                file_handle(),
+                                                begin(datagrams),
+                                                end(datagrams),
+                                                MSG_NOSIGNAL,
+                                                wrap_token(std::forward<CompletionToken>(token)));
+  }
+  /**
+   *  Begins receiving datagrams continuously into
+   *  buffers selected from a \ref buffer_ring only once
+   *  they arrive.
+   *
+   *  A single multishot `IORING_OP_RECVMSG` is submitted
+   *  which yields a completion for each datagram.
+   *  Each buffer holds the sender's address ahead of
+   *  the payload and accordingly the buffer size of the
+   *  ring must exceed `sizeof(::io_uring_recvmsg_out)`
+   *  and `sizeof(Address)` combined. Requires Linux 6.0
+   *  or later (otherwise the stream ends immediately with
+   *  an error).
+   *
+   *  The handler is invoked as for
+   *  \ref poll_file::async_receive_multishot.
+   *
+   *  \tparam Address
+   *    The type of socket address.
+   *  \tparam Handler
+   *    A function object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         received_datagram<Address>);
+   *    \endcode
+   *    Which is invoked with a falsy error code and
+   *    a \ref received_datagram for each datagram. The
+   *    stream ends with a single invocation with a truthy
+   *    error code after which the handler is not invoked
+   *    again: `ENOBUFS` if the ring is exhausted (release
+   *    datagrams and begin again), `boost::asio::error::operation_aborted`
+   *    after \ref cancel, or `boost::asio::error::try_again`
+   *    if the kernel ended the stream for any other
+   *    reason.
+   *
+   *  \param [in] ring
+   *    The \ref buffer_ring. This reference must remain
+   *    valid until the stream ends or the behavior is
+   *    undefined.
+   *  \param [in] h
+   *    The handler.
+   */
+  template<typename Address,
+           typename Handler>
+  void async_receive_from_multishot(buffer_ring& ring,
+                                    Handler h)
+  {
+    using datagram_type = received_datagram<Address>;
+    //  Intermediate completions bypass the wrapper so
+    //  that the file descriptor is kept alive until
+    //  the stream ends
+    get_service().initiate_recvmsg_multishot(get_implementation(),
+                                             file_handle(),
+                                             ring,
+                                             sizeof(Address),
+                                             [w = wrap_handler(std::move(h))](boost::system::error_code ec,
+                                                                              buffer_ring::lease lease,
+                                                                              bool more) mutable
+                                             {
+                                               if (more) {
+                                                 w.completion_handler()(ec,
+                                                                        datagram_type(std::move(lease)));
+                                                 return;
+                                               }
+                                               if (!ec) {
+                                                 w.completion_handler()(ec,
+                                                                        datagram_type(std::move(lease)));
+                                                 ec = make_error_code(boost::asio::error::try_again);
+                                               }
+                                               w(ec,
+                                                 datagram_type());
+                                             });
+  }
+};
+
+}
@@ -0,0 +1,19 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <asio_uring/execution_context_pool.hpp>
+#include "execution_context.hpp"
+
+namespace asio_uring::asio {
+
+/**
+ *  A \ref asio_uring::basic_execution_context_pool of
+ *  \ref execution_context objects so that each shard
+ *  may host Boost.Asio services and I/O objects.
+ */
+using execution_context_pool = basic_execution_context_pool<execution_context>;
+
+}
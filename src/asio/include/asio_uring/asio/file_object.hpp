@@ -49,9 +49,18 @@ public:
    *  \param [in] file
    *    The \ref fd "file descriptor" to wrap. Must not be an
    *    invalid file descriptor or the behavior is undefined.
+   *  \param [in] fixed
+   *    If `true` the file descriptor is installed in the
+   *    registered file table of `ctx` (see
+   *    \ref asio_uring::execution_context::register_file "register_file")
+   *    and all operations refer to it thereby (i.e. with
+   *    `IOSQE_FIXED_FILE`). The slot is released once the
+   *    file descriptor is no longer in use. Defaults to
+   *    `false`.
    */
   file_object(execution_context& ctx,
-              fd file);
+              fd file,
+              bool fixed = false);
   /** 
    *  @{
    *  Obtains the raw file descripctor.
@@ -64,7 +73,40 @@ public:
   /**
    *  @}
    */
+  /**
+   *  Determines whether the file descriptor is
+   *  installed in the registered file table of the
+   *  associated \ref execution_context.
+   *
+   *  \return
+   *    `true` if so, `false` otherwise.
+   */
+  bool fixed() const noexcept;
+  /**
+   *  Requests cancellation (`IORING_OP_ASYNC_CANCEL`) of
+   *  all operations outstanding against this object.
+   *
+   *  Cancelled operations complete with either
+   *  `boost::asio::error::operation_aborted` or
+   *  `ECANCELED` (if the operation was already in
+   *  progress and interrupted) unless they complete
+   *  normally before the request takes effect. The
+   *  requests themselves are neither work nor handlers
+   *  of the execution context.
+   */
+  void cancel();
 protected:
+  /**
+   *  Obtains the \ref service::file "file" against which
+   *  operations on the owned file descriptor should be
+   *  initiated: Either the raw file descriptor or its
+   *  index in the registered file table (see
+   *  \ref fixed).
+   *
+   *  \return
+   *    A \ref service::file "file".
+   */
+  service::file file_handle() const noexcept;
   /**
    *  Wraps a completion handler such that all properties
    *  of the completion handler are preserved and such
@@ -144,6 +186,7 @@ protected:
   long outstanding() const noexcept;
 private:
   std::shared_ptr<fd> fd_;
+  int                 index_;
 };
 
 }
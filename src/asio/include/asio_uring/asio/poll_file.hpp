@@ -9,11 +9,13 @@
 #include <memory>
 #include <type_traits>
 #include <utility>
+#include <asio_uring/buffer_ring.hpp>
 #include <asio_uring/fd.hpp>
 #include <boost/asio/associated_allocator.hpp>
 #include <boost/asio/associated_executor.hpp>
 #include <boost/asio/async_result.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/asio/post.hpp>
 #include <boost/system/error_code.hpp>
 #include "execution_context.hpp"
@@ -21,6 +23,7 @@
 #include "read.hpp"
 #include "write.hpp"
 #include <sys/poll.h>
+#include <sys/socket.h>
 
 namespace asio_uring::asio {
 
@@ -48,6 +51,32 @@ private:
   CompletionHandler h_;
 };
 
+template<typename SentHandler,
+         typename CompletionHandler>
+class write_zc_op {
+public:
+  write_zc_op(SentHandler s,
+              CompletionHandler h) noexcept(std::is_nothrow_move_constructible_v<SentHandler> &&
+                                            std::is_nothrow_move_constructible_v<CompletionHandler>)
+    : s_(std::move(s)),
+      h_(std::move(h))
+  {}
+  void operator()(boost::system::error_code ec,
+                  std::size_t bytes_transferred)
+  {
+    s_(ec,
+       bytes_transferred);
+    h_(ec,
+       bytes_transferred);
+  }
+  const CompletionHandler& completion_handler() const noexcept {
+    return h_;
+  }
+private:
+  SentHandler       s_;
+  CompletionHandler h_;
+};
+
 }
 
 /**
@@ -60,6 +89,15 @@ private:
  *  - `AsyncReadStream`
  *  - `AsyncWriteStream`
  *
+ *  When the file descriptor is a socket and the kernel
+ *  supports it \ref async_read_some and
+ *  \ref async_write_some submit `IORING_OP_RECV` and
+ *  `IORING_OP_SEND` respectively so that the kernel
+ *  performs the transfer itself once the socket is
+ *  ready (see \ref native). Otherwise they wait for
+ *  readiness and then perform a non-blocking `read` or
+ *  `write`.
+ *
  *  \sa
  *    async_file
  */
@@ -70,8 +108,40 @@ private:
 public:
 #ifndef ASIO_URING_DOXYGEN_RUNNING
   poll_file(execution_context& ctx,
-            fd file);
+            fd file,
+            bool fixed = false);
 #endif
+  /**
+   *  Determines whether \ref async_read_some and
+   *  \ref async_write_some submit `IORING_OP_RECV`
+   *  and `IORING_OP_SEND` rather than waiting for
+   *  readiness.
+   *
+   *  This is the case when the file descriptor is a
+   *  socket and the kernel supports both operations
+   *  as well as `IORING_FEAT_FAST_POLL` (without which
+   *  the kernel fails operations on non-blocking sockets
+   *  which are not ready rather than waiting for them).
+   *
+   *  \return
+   *    `true` if so, `false` otherwise.
+   */
+  bool native() const noexcept;
+  /**
+   *  Determines whether \ref async_write_some_zc
+   *  submits `IORING_OP_SEND_ZC` rather than falling
+   *  back to \ref async_write_some.
+   *
+   *  This is the case when \ref native is and the
+   *  file descriptor is an `AF_INET` or `AF_INET6`
+   *  socket (the kernel does not support zero copy
+   *  for other families) and the kernel supports the
+   *  operation.
+   *
+   *  \return
+   *    `true` if so, `false` otherwise.
+   */
+  bool zero_copy() const noexcept;
   /**
    *  Initiates an asynchronous operation which
    *  completes when the owned file descriptor
@@ -99,7 +169,7 @@ public:
   template<typename CompletionToken>
   auto async_poll_in(CompletionToken&& token) {
     return get_service().initiate_poll_add(get_implementation(),
-                                           native_handle(),
+                                           file_handle(),
                                            POLLIN,
                                            wrap_token(std::forward<CompletionToken>(token)));
   }
@@ -130,7 +200,7 @@ public:
   template<typename CompletionToken>
   auto async_poll_out(CompletionToken&& token) {
     return get_service().initiate_poll_add(get_implementation(),
-                                           native_handle(),
+                                           file_handle(),
                                            POLLOUT,
                                            wrap_token(std::forward<CompletionToken>(token)));
   }
@@ -250,15 +320,34 @@ protected:
     return result.get();
   }
 private:
+  template<typename Buffer,
+           typename BufferSequence>
+  static Buffer first_buffer(const BufferSequence& bs) {
+    for (auto begin = boost::asio::buffer_sequence_begin(bs), end = boost::asio::buffer_sequence_end(bs);
+         begin != end;
+         ++begin)
+    {
+      Buffer buffer(*begin);
+      if (buffer.size()) {
+        return buffer;
+      }
+    }
+    return Buffer();
+  }
   template<bool In,
            typename BufferSequence,
            typename Invoker,
+           typename Native,
            typename CompletionToken>
   auto async_impl(BufferSequence bs,
                   Invoker i,
+                  Native n,
                   CompletionToken&& token)
   {
     if (boost::asio::buffer_size(bs)) {
+      if (native_) {
+        return n(wrap_token(std::forward<CompletionToken>(token)));
+      }
       return async_poll_then<In,
                              signature>(std::move(i),
                                         std::forward<CompletionToken>(token));
@@ -267,6 +356,8 @@ private:
                 boost::system::error_code(),
                 std::size_t(0));
   }
+  bool native_;
+  bool zero_copy_;
 public:
   /**
    *  Asynchronously reads from the file descriptor.
@@ -324,6 +415,15 @@ public:
                               h(ec,
                                 bytes_transferred);
                             },
+                            [&](auto&& t) {
+                              //  Only the first non-empty buffer is
+                              //  filled which read_some permits
+                              return get_service().initiate_recv(get_implementation(),
+                                                                 file_handle(),
+                                                                 first_buffer<boost::asio::mutable_buffer>(mb),
+                                                                 0,
+                                                                 std::move(t));
+                            },
                             std::forward<CompletionToken>(token));
   }
   /**
@@ -375,8 +475,217 @@ public:
                                h(ec,
                                  bytes_transferred);
                              },
+                             [&](auto&& t) {
+                               return get_service().initiate_send(get_implementation(),
+                                                                  file_handle(),
+                                                                  first_buffer<boost::asio::const_buffer>(cb),
+                                                                  MSG_NOSIGNAL,
+                                                                  std::move(t));
+                             },
                              std::forward<CompletionToken>(token));
   }
+  /**
+   *  Asynchronously writes to the socket without
+   *  copying the data into the kernel.
+   *
+   *  `IORING_OP_SEND_ZC` is submitted so that the
+   *  network stack transmits directly from the buffer
+   *  (see \ref zero_copy, otherwise this is equivalent
+   *  to \ref async_write_some). Since the buffer is
+   *  then referenced until the data has been sent
+   *  (rather than until the call accepts the data)
+   *  the operation has two stages: `sent` is invoked
+   *  once the bytes have been accepted and the
+   *  completion handler once the kernel no longer
+   *  references the buffer. This is only worthwhile
+   *  for large writes.
+   *
+   *  Only the first non-empty buffer is written.
+   *
+   *  \tparam ConstBufferSequence
+   *    A type which models `ConstBufferSequence`.
+   *  \tparam SentHandler
+   *    A function object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Which is invoked exactly once with the result of
+   *    the operation and the number of bytes written
+   *    before the completion handler. Unlike a completion
+   *    handler it is invoked directly on a thread running
+   *    the associated \ref execution_context (its associated
+   *    executor, if any, is not used).
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the arguments are the same as those provided
+   *    to `sent`.
+   *
+   *  \param [in] cb
+   *    The buffers from which to write bytes. Note that
+   *    while this object itself will be copied as needed
+   *    the underlying buffers must remain valid until
+   *    the completion handler is invoked (not merely
+   *    until `sent` is invoked) or the behavior is
+   *    undefined.
+   *  \param [in] sent
+   *    The function object to invoke once the bytes have
+   *    been accepted.
+   *  \param [in] token
+   *    A completion token to use to notify the caller of
+   *    completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename ConstBufferSequence,
+           typename SentHandler,
+           typename CompletionToken>
+  auto async_write_some_zc(ConstBufferSequence cb,
+                           SentHandler sent,
+                           CompletionToken&& token)
+  {
+    if (zero_copy_ && boost::asio::buffer_size(cb)) {
+      return get_service().initiate_send_zc(get_implementation(),
+                                            file_handle(),
+                                            first_buffer<boost::asio::const_buffer>(cb),
+                                            MSG_NOSIGNAL,
+                                            std::move(sent),
+                                            wrap_token(std::forward<CompletionToken>(token)));
+    }
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    async_write_some(cb,
+                     detail::write_zc_op(std::move(sent),
+                                         std::move(h)));
+    return result.get();
+  }
+  /**
+   *  Asynchronously writes to the socket without
+   *  copying the data into the kernel, notifying the
+   *  caller only once the buffer may be reused.
+   *
+   *  Equivalent to calling \ref async_write_some_zc(ConstBufferSequence,SentHandler,CompletionToken&&)
+   *  with a `sent` which does nothing.
+   *
+   *  \tparam ConstBufferSequence
+   *    A type which models `ConstBufferSequence`.
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion handler
+   *    is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         std::size_t);
+   *    \endcode
+   *    Where the first argument is the result of the
+   *    operation and the second argument is the number
+   *    of bytes written.
+   *
+   *  \param [in] cb
+   *    The buffers from which to write bytes. The
+   *    underlying buffers must remain valid until the
+   *    completion handler is invoked or the behavior is
+   *    undefined.
+   *  \param [in] token
+   *    A completion token to use to notify the caller of
+   *    completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken` and
+   *    `token`.
+   */
+  template<typename ConstBufferSequence,
+           typename CompletionToken>
+  auto async_write_some_zc(ConstBufferSequence cb,
+                           CompletionToken&& token)
+  {
+    return async_write_some_zc(cb,
+                               [](boost::system::error_code,
+                                  std::size_t) noexcept {},
+                               std::forward<CompletionToken>(token));
+  }
+  /**
+   *  Begins receiving from the socket continuously
+   *  into buffers selected from a \ref buffer_ring
+   *  only once data arrives.
+   *
+   *  A single multishot `IORING_OP_RECV` is submitted
+   *  which yields a completion for each receive so that
+   *  a connection which is idle holds no buffer.
+   *  Requires a socket and Linux 6.0 or later (otherwise
+   *  the stream ends immediately with an error).
+   *
+   *  Unlike a completion handler the handler is
+   *  invoked directly on a thread running the
+   *  associated \ref execution_context (its associated
+   *  executor, if any, is not used) and the execution
+   *  context does not run out of work until the stream
+   *  ends.
+   *
+   *  \tparam Handler
+   *    A function object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(boost::system::error_code,
+   *         buffer_ring::lease);
+   *    \endcode
+   *    Which is invoked with a falsy error code and a
+   *    \ref buffer_ring::lease "lease" on the received
+   *    data for each receive. The stream ends with a
+   *    single invocation with a truthy error code after
+   *    which the handler is not invoked again:
+   *    `boost::asio::error::eof` once the peer shuts
+   *    down, `ENOBUFS` if the ring is exhausted (release
+   *    leases and begin again), `boost::asio::error::operation_aborted`
+   *    after \ref cancel, or `boost::asio::error::try_again`
+   *    if the kernel ended the stream for any other
+   *    reason.
+   *
+   *  \param [in] ring
+   *    The \ref buffer_ring. This reference must remain
+   *    valid until the stream ends or the behavior is
+   *    undefined.
+   *  \param [in] h
+   *    The handler.
+   */
+  template<typename Handler>
+  void async_receive_multishot(buffer_ring& ring,
+                               Handler h)
+  {
+    //  Intermediate completions bypass the wrapper so
+    //  that the file descriptor is kept alive until
+    //  the stream ends
+    get_service().initiate_recv_multishot(get_implementation(),
+                                          file_handle(),
+                                          ring,
+                                          [w = wrap_handler(std::move(h))](boost::system::error_code ec,
+                                                                           buffer_ring::lease lease,
+                                                                           bool more) mutable
+                                          {
+                                            if (more) {
+                                              w.completion_handler()(ec,
+                                                                     std::move(lease));
+                                              return;
+                                            }
+                                            if (!ec) {
+                                              w.completion_handler()(ec,
+                                                                     std::move(lease));
+                                              ec = make_error_code(boost::asio::error::try_again);
+                                            }
+                                            w(ec,
+                                              buffer_ring::lease());
+                                          });
+  }
 };
 
 }
@@ -424,5 +733,45 @@ public:
   }
 };
 
+template<typename SentHandler,
+         typename CompletionHandler,
+         typename Allocator>
+class associated_allocator<::asio_uring::asio::detail::write_zc_op<SentHandler,
+                                                                   CompletionHandler>,
+                           Allocator>
+{
+public:
+  using type = typename associated_allocator<CompletionHandler,
+                                             Allocator>::type;
+
+  static auto get(const ::asio_uring::asio::detail::write_zc_op<SentHandler,
+                                                                CompletionHandler>& h,
+                  const Allocator& alloc = Allocator())
+  {
+    return asio::get_associated_allocator(h.completion_handler(),
+                                          alloc);
+  }
+};
+
+template<typename SentHandler,
+         typename CompletionHandler,
+         typename Executor>
+class associated_executor<::asio_uring::asio::detail::write_zc_op<SentHandler,
+                                                                  CompletionHandler>,
+                          Executor>
+{
+public:
+  using type = typename associated_executor<CompletionHandler,
+                                            Executor>::type;
+
+  static auto get(const ::asio_uring::asio::detail::write_zc_op<SentHandler,
+                                                                CompletionHandler>& h,
+                  const Executor& ex = Executor())
+  {
+    return asio::get_associated_executor(h.completion_handler(),
+                                         ex);
+  }
+};
+
 }
 #endif
@@ -4,20 +4,33 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
+#include <optional>
 #include <type_traits>
 #include <utility>
 #include <asio_uring/asio/completion_handler.hpp>
 #include <asio_uring/asio/iovec.hpp>
+#include <asio_uring/buffer_ring.hpp>
+#include <asio_uring/fd.hpp>
 #include <asio_uring/liburing.hpp>
 #include <asio_uring/service.hpp>
+#include <boost/asio/associated_allocator.hpp>
 #include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/asio/execution_context.hpp>
 #include <boost/system/error_code.hpp>
 #include "execution_context.hpp"
+#include <errno.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 
 namespace asio_uring::asio {
@@ -40,6 +53,58 @@ namespace asio_uring::asio {
 class service : public asio_uring::service,
                 public boost::asio::execution_context::service
 {
+public:
+  /**
+   *  Identifies the file against which an operation
+   *  is initiated: Either a raw file descriptor or
+   *  the index of a slot in the registered file table
+   *  of the associated \ref execution_context (see
+   *  \ref asio_uring::execution_context::register_file "register_file").
+   */
+  class file {
+  public:
+    file() = delete;
+    /**
+     *  Creates a file.
+     *
+     *  \param [in] fd
+     *    A raw file descriptor or, if `fixed` is
+     *    `true`, the index of a registered file.
+     *  \param [in] fixed
+     *    `true` if `fd` is the index of a registered
+     *    file, `false` otherwise. Defaults to `false`.
+     */
+    file(int fd,
+         bool fixed = false) noexcept;
+    /**
+     *  Obtains the value to place in the `fd` field
+     *  of a submission queue entry.
+     *
+     *  \return
+     *    The file descriptor or index.
+     */
+    int native_handle() const noexcept;
+    /**
+     *  Determines whether this object refers to a
+     *  registered file.
+     *
+     *  \return
+     *    `true` if so, `false` otherwise.
+     */
+    bool fixed() const noexcept;
+    /**
+     *  Sets `IOSQE_FIXED_FILE` on a submission queue
+     *  entry if this object refers to a registered
+     *  file.
+     *
+     *  \param [in] sqe
+     *    The submission queue entry.
+     */
+    void set_flags(::io_uring_sqe& sqe) const noexcept;
+  private:
+    int  fd_;
+    bool fixed_;
+  };
 private:
   using rw_signature = void(boost::system::error_code,
                             std::size_t);
@@ -51,6 +116,12 @@ private:
   static boost::system::error_code to_poll_add_result(int) noexcept;
   static boost::system::error_code to_poll_remove_result(int) noexcept;
   static boost::system::error_code to_fsync_result(int) noexcept;
+  static boost::system::error_code to_multishot_result(int) noexcept;
+  static std::uint64_t to_user_data(const void*) noexcept;
+  static boost::system::error_code to_connect_result(int) noexcept;
+  static boost::system::error_code to_batch_result(int) noexcept;
+  static boost::system::error_code to_timeout_result(int) noexcept;
+  static ::__kernel_timespec to_timespec(std::chrono::nanoseconds) noexcept;
   template<typename Function>
   static auto make_rw_completion(Function f) {
     return [func = std::move(f)](auto&& cqe) mutable {
@@ -62,7 +133,7 @@ private:
   template<typename BufferSequence,
            typename CompletionToken>
   auto initiate_rw_some_at(implementation_type& impl,
-                           int fd,
+                           file f,
                            void (*prep)(::io_uring_sqe*,
                                         int,
                                         ::iovec*,
@@ -91,15 +162,238 @@ private:
                to_iovecs(bs,
                          iovs);
                prep(&sqe,
-                    fd,
+                    f.native_handle(),
                     iovs,
                     n,
                     o);
+               f.set_flags(sqe);
              },
              make_rw_completion(std::move(wrapper)),
              alloc);
     return result.get();
   }
+  template<typename Function,
+           typename CompletionToken>
+  auto initiate_rw(implementation_type& impl,
+                   Function prep,
+                   CompletionToken&& token)
+  {
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        rw_signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    completion_handler wrapper(std::move(h),
+                               context().get_executor());
+    auto alloc = wrapper.get_allocator();
+    initiate(impl,
+             [&](auto&& sqe,
+                 auto) noexcept
+             {
+               prep(sqe);
+             },
+             make_rw_completion(std::move(wrapper)),
+             alloc);
+    return result.get();
+  }
+  template<typename Function,
+           typename CompletionToken>
+  auto initiate_timed(implementation_type& impl,
+                      std::size_t iovs,
+                      std::optional<std::chrono::nanoseconds> timeout,
+                      Function prep,
+                      boost::system::error_code (*to_result)(int),
+                      CompletionToken&& token)
+  {
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        poll_signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    completion_handler wrapper(std::move(h),
+                               context().get_executor());
+    auto alloc = wrapper.get_allocator();
+    auto f = [&](auto&& sqe,
+                 auto iovs,
+                 auto) noexcept
+    {
+      prep(sqe,
+           iovs);
+    };
+    if (!timeout) {
+      initiate(impl,
+               iovs,
+               f,
+               [w = std::move(wrapper),
+                to_result](auto&& cqe) mutable
+               {
+                 w(to_result(cqe.res));
+               },
+               alloc);
+      return result.get();
+    }
+    initiate(impl,
+             iovs,
+             to_timespec(*timeout),
+             f,
+             [w = std::move(wrapper),
+              to_result](auto&& cqe) mutable
+             {
+               //  An operation cancelled because the linked
+               //  timeout fired completes with -ETIME (see
+               //  execution_context::submit)
+               if (cqe.res == -ETIME) {
+                 w(make_error_code(boost::asio::error::timed_out));
+                 return;
+               }
+               w(to_result(cqe.res));
+             },
+             alloc);
+    return result.get();
+  }
+  static constexpr std::size_t to_iovs(std::size_t bytes) noexcept {
+    return (bytes + sizeof(::iovec) - 1) / sizeof(::iovec);
+  }
+  //  A message header is laid out in the iovecs after
+  //  those which describe the buffers followed by any
+  //  storage for the address
+  static constexpr std::size_t msghdr_iovs = (sizeof(::msghdr) + sizeof(::iovec) - 1) / sizeof(::iovec);
+  static_assert(alignof(::msghdr) <= alignof(::iovec));
+  template<typename BufferSequence>
+  static ::msghdr& to_msghdr(BufferSequence bs,
+                             std::size_t n,
+                             ::iovec* iovs) noexcept
+  {
+    to_iovecs(bs,
+              iovs);
+    auto msg = ::new(static_cast<void*>(iovs + n)) ::msghdr{};
+    msg->msg_iov = iovs;
+    msg->msg_iovlen = n;
+    return *msg;
+  }
+  template<typename BufferSequence,
+           typename Function,
+           typename CompletionToken>
+  auto initiate_msg(implementation_type& impl,
+                    BufferSequence bs,
+                    ::socklen_t storage,
+                    Function prep,
+                    CompletionToken&& token)
+  {
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        rw_signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    completion_handler wrapper(std::move(h),
+                               context().get_executor());
+    std::size_t n(std::distance(boost::asio::buffer_sequence_begin(bs),
+                                boost::asio::buffer_sequence_end(bs)));
+    auto alloc = wrapper.get_allocator();
+    initiate(impl,
+             n + msghdr_iovs + to_iovs(storage),
+             [&](auto&& sqe,
+                 auto iovs,
+                 auto) noexcept
+             {
+               prep(sqe,
+                    to_msghdr(bs,
+                              n,
+                              iovs),
+                    iovs + n + msghdr_iovs);
+             },
+             make_rw_completion(std::move(wrapper)),
+             alloc);
+    return result.get();
+  }
+  template<typename CompletionHandler>
+  class batch_state {
+  public:
+    batch_state(CompletionHandler h,
+                std::size_t n) noexcept(std::is_nothrow_move_constructible_v<CompletionHandler>)
+      : h_        (std::move(h)),
+        remaining_(n),
+        completed_(0),
+        error_    (0),
+        abandoned_(false)
+    {}
+    void operator()(int res) {
+      if (res < 0) {
+        //  Only the first failure is reported
+        int expected = 0;
+        error_.compare_exchange_strong(expected,
+                                       res,
+                                       std::memory_order_relaxed);
+      } else {
+        completed_.fetch_add(1,
+                             std::memory_order_relaxed);
+      }
+      finish(1);
+    }
+    void abandon(std::size_t n) {
+      abandoned_.store(true,
+                       std::memory_order_relaxed);
+      finish(n);
+    }
+  private:
+    void finish(std::size_t n) {
+      if (remaining_.fetch_sub(n,
+                               std::memory_order_acq_rel) != n)
+      {
+        return;
+      }
+      //  If initiation failed part way through the
+      //  handler is destroyed rather than invoked
+      if (abandoned_.load(std::memory_order_relaxed)) {
+        return;
+      }
+      int error = error_.load(std::memory_order_relaxed);
+      h_(error ? to_batch_result(error) : boost::system::error_code(),
+         completed_.load(std::memory_order_relaxed));
+    }
+    CompletionHandler        h_;
+    std::atomic<std::size_t> remaining_;
+    std::atomic<std::size_t> completed_;
+    std::atomic<int>         error_;
+    std::atomic<bool>        abandoned_;
+  };
+  template<typename Function,
+           typename Handler>
+  void initiate_buffer_select(implementation_type& impl,
+                              std::size_t iovs,
+                              buffer_ring& ring,
+                              Function prep,
+                              Handler h)
+  {
+    auto alloc = boost::asio::get_associated_allocator(h);
+    initiate(impl,
+             iovs,
+             [&](auto&& sqe,
+                 auto iovs,
+                 auto) noexcept
+             {
+               prep(sqe,
+                    iovs);
+               sqe.flags |= IOSQE_BUFFER_SELECT;
+               sqe.buf_group = ring.group();
+             },
+             [&ring,
+              h = std::move(h)](auto&& cqe) mutable
+             {
+               bool more = cqe.flags & IORING_CQE_F_MORE;
+               auto lease = ring.get(cqe);
+               boost::system::error_code ec;
+               if (cqe.res < 0) {
+                 ec = to_multishot_result(cqe.res);
+               } else if (!cqe.res && !more) {
+                 ec = make_error_code(boost::asio::error::eof);
+               }
+               h(ec,
+                 std::move(lease),
+                 more);
+             },
+             alloc);
+  }
 public:
   /**
    *  A type alias for this type.
@@ -135,6 +429,27 @@ public:
    *    service teardown process).
    */
   explicit service(boost::asio::execution_context& ctx);
+  /**
+   *  Creates a service which is associated with a
+   *  particular `boost::asio::execution_context` and which
+   *  manages its pool of completion objects as described by
+   *  \ref asio_uring::service::service(asio_uring::execution_context&,std::size_t,std::size_t) "the corresponding constructor of asio_uring::service".
+   *
+   *  Use with `boost::asio::make_service` to configure the
+   *  service before any I/O objects are created.
+   *
+   *  \param [in] ctx
+   *    See \ref service(boost::asio::execution_context&).
+   *  \param [in] prewarm
+   *    The number of completion objects to allocate
+   *    immediately.
+   *  \param [in] high_water_mark
+   *    The number of idle completion objects above which
+   *    idle memory is freed.
+   */
+  service(boost::asio::execution_context& ctx,
+          std::size_t prewarm,
+          std::size_t high_water_mark = std::numeric_limits<std::size_t>::max());
   /**
    *  Obtains a reference to the associated \ref execution_context.
    *
@@ -149,13 +464,13 @@ public:
   template<typename MutableBufferSequence,
            typename CompletionToken>
   auto initiate_read_some_at(implementation_type& impl,
-                             int fd,
+                             file f,
                              std::uint64_t o,
                              MutableBufferSequence mb,
                              CompletionToken&& token)
   {
     return initiate_rw_some_at(impl,
-                               fd,
+                               f,
                                &::io_uring_prep_readv,
                                o,
                                mb,
@@ -164,26 +479,105 @@ public:
   template<typename ConstBufferSequence,
            typename CompletionToken>
   auto initiate_write_some_at(implementation_type& impl,
-                              int fd,
+                              file f,
                               std::uint64_t o,
                               ConstBufferSequence cb,
                               CompletionToken&& token)
   {
     return initiate_rw_some_at(impl,
-                               fd,
+                               f,
                                &::io_uring_prep_writev,
                                o,
                                cb,
                                std::forward<CompletionToken>(token));
   }
   template<typename CompletionToken>
-  auto initiate_poll_add(implementation_type& impl,
-                         int fd,
-                         short mask,
-                         CompletionToken&& token)
+  auto initiate_read_some_at_fixed(implementation_type& impl,
+                                   file f,
+                                   std::uint64_t o,
+                                   boost::asio::mutable_buffer mb,
+                                   int buf_index,
+                                   CompletionToken&& token)
+  {
+    return initiate_rw(impl,
+                       [&](auto&& sqe) noexcept {
+                         ::io_uring_prep_read_fixed(&sqe,
+                                                    f.native_handle(),
+                                                    mb.data(),
+                                                    mb.size(),
+                                                    o,
+                                                    buf_index);
+                         f.set_flags(sqe);
+                       },
+                       std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
+  auto initiate_write_some_at_fixed(implementation_type& impl,
+                                    file f,
+                                    std::uint64_t o,
+                                    boost::asio::const_buffer cb,
+                                    int buf_index,
+                                    CompletionToken&& token)
+  {
+    return initiate_rw(impl,
+                       [&](auto&& sqe) noexcept {
+                         ::io_uring_prep_write_fixed(&sqe,
+                                                     f.native_handle(),
+                                                     cb.data(),
+                                                     cb.size(),
+                                                     o,
+                                                     buf_index);
+                         f.set_flags(sqe);
+                       },
+                       std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
+  auto initiate_recv(implementation_type& impl,
+                     file f,
+                     boost::asio::mutable_buffer mb,
+                     int flags,
+                     CompletionToken&& token)
+  {
+    return initiate_rw(impl,
+                       [&](auto&& sqe) noexcept {
+                         ::io_uring_prep_recv(&sqe,
+                                              f.native_handle(),
+                                              mb.data(),
+                                              mb.size(),
+                                              flags);
+                         f.set_flags(sqe);
+                       },
+                       std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
+  auto initiate_send(implementation_type& impl,
+                     file f,
+                     boost::asio::const_buffer cb,
+                     int flags,
+                     CompletionToken&& token)
+  {
+    return initiate_rw(impl,
+                       [&](auto&& sqe) noexcept {
+                         ::io_uring_prep_send(&sqe,
+                                              f.native_handle(),
+                                              cb.data(),
+                                              cb.size(),
+                                              flags);
+                         f.set_flags(sqe);
+                       },
+                       std::forward<CompletionToken>(token));
+  }
+  template<typename SentHandler,
+           typename CompletionToken>
+  auto initiate_send_zc(implementation_type& impl,
+                        file f,
+                        boost::asio::const_buffer cb,
+                        int flags,
+                        SentHandler sent,
+                        CompletionToken&& token)
   {
     using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
-                                                        poll_signature>;
+                                                        rw_signature>;
     using completion_handler_type = typename async_result_type::completion_handler_type;
     completion_handler_type h(std::forward<CompletionToken>(token));
     async_result_type result(h);
@@ -194,17 +588,99 @@ public:
              [&](auto&& sqe,
                  auto) noexcept
              {
-               ::io_uring_prep_poll_add(&sqe,
-                                        fd,
-                                        mask);
+               ::io_uring_prep_send_zc(&sqe,
+                                       f.native_handle(),
+                                       cb.data(),
+                                       cb.size(),
+                                       flags,
+                                       0);
+               f.set_flags(sqe);
              },
-             [w = std::move(wrapper)](auto&& cqe) mutable {
-               w(to_poll_add_result(cqe.res));
+             //  The result arrives first (with IORING_CQE_F_MORE
+             //  set if a notification follows) and the
+             //  notification once the kernel no longer
+             //  references the buffer
+             [w = std::move(wrapper),
+              sent = std::move(sent),
+              res = rw_result_type()](auto&& cqe) mutable
+             {
+               if (!(cqe.flags & IORING_CQE_F_NOTIF)) {
+                 res = to_rw_result(cqe.res);
+                 sent(res.first,
+                      res.second);
+                 if (cqe.flags & IORING_CQE_F_MORE) {
+                   return;
+                 }
+               }
+               w(res.first,
+                 res.second);
              },
              alloc);
     return result.get();
   }
   template<typename CompletionToken>
+  auto initiate_poll_add(implementation_type& impl,
+                         file f,
+                         short mask,
+                         CompletionToken&& token)
+  {
+    return initiate_poll_add(impl,
+                             f,
+                             mask,
+                             std::nullopt,
+                             std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
+  auto initiate_poll_add(implementation_type& impl,
+                         file f,
+                         short mask,
+                         std::optional<std::chrono::nanoseconds> timeout,
+                         CompletionToken&& token)
+  {
+    return initiate_timed(impl,
+                          0,
+                          timeout,
+                          [&](auto&& sqe,
+                              auto) noexcept
+                          {
+                            ::io_uring_prep_poll_add(&sqe,
+                                                     f.native_handle(),
+                                                     mask);
+                            f.set_flags(sqe);
+                          },
+                          &to_poll_add_result,
+                          std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
+  auto initiate_connect(implementation_type& impl,
+                        file f,
+                        const ::sockaddr* addr,
+                        ::socklen_t addr_len,
+                        std::optional<std::chrono::nanoseconds> timeout,
+                        CompletionToken&& token)
+  {
+    //  The kernel reads the address when the entry is
+    //  submitted (which may be deferred) so it is copied
+    //  into the iovecs which live as long as the operation
+    return initiate_timed(impl,
+                          to_iovs(addr_len),
+                          timeout,
+                          [&](auto&& sqe,
+                              auto iovs) noexcept
+                          {
+                            std::memcpy(iovs,
+                                        addr,
+                                        addr_len);
+                            ::io_uring_prep_connect(&sqe,
+                                                    f.native_handle(),
+                                                    reinterpret_cast<const ::sockaddr*>(iovs),
+                                                    addr_len);
+                            f.set_flags(sqe);
+                          },
+                          &to_connect_result,
+                          std::forward<CompletionToken>(token));
+  }
+  template<typename CompletionToken>
   auto initiate_poll_remove(implementation_type& impl,
                             const void* user_data,
                             CompletionToken&& token)
@@ -230,9 +706,311 @@ public:
              alloc);
     return result.get();
   }
+  template<typename Handler>
+  void initiate_accept_multishot(implementation_type& impl,
+                                 file f,
+                                 Handler h)
+  {
+    auto alloc = boost::asio::get_associated_allocator(h);
+    initiate(impl,
+             [&](auto&& sqe,
+                 auto) noexcept
+             {
+               ::io_uring_prep_multishot_accept(&sqe,
+                                                f.native_handle(),
+                                                nullptr,
+                                                nullptr,
+                                                SOCK_NONBLOCK);
+               f.set_flags(sqe);
+             },
+             [h = std::move(h)](auto&& cqe) mutable {
+               bool more = cqe.flags & IORING_CQE_F_MORE;
+               if (cqe.res < 0) {
+                 h(to_multishot_result(cqe.res),
+                   fd(),
+                   more);
+                 return;
+               }
+               h(boost::system::error_code(),
+                 fd(cqe.res),
+                 more);
+             },
+             alloc);
+  }
+  template<typename Handler>
+  void initiate_recv_multishot(implementation_type& impl,
+                               file f,
+                               buffer_ring& ring,
+                               Handler h)
+  {
+    initiate_buffer_select(impl,
+                           0,
+                           ring,
+                           [&](auto&& sqe,
+                               auto) noexcept
+                           {
+                             ::io_uring_prep_recv_multishot(&sqe,
+                                                            f.native_handle(),
+                                                            nullptr,
+                                                            0,
+                                                            0);
+                             f.set_flags(sqe);
+                           },
+                           std::move(h));
+  }
+  template<typename ConstBufferSequence,
+           typename CompletionToken>
+  auto initiate_sendmsg(implementation_type& impl,
+                        file f,
+                        ConstBufferSequence cb,
+                        const ::sockaddr* addr,
+                        ::socklen_t addr_len,
+                        int flags,
+                        CompletionToken&& token)
+  {
+    //  The kernel reads the address when the entry is
+    //  submitted (which may be deferred) so it is copied
+    return initiate_msg(impl,
+                        cb,
+                        addr_len,
+                        [&](auto&& sqe,
+                            auto&& msg,
+                            auto storage) noexcept
+                        {
+                          std::memcpy(storage,
+                                      addr,
+                                      addr_len);
+                          msg.msg_name = storage;
+                          msg.msg_namelen = addr_len;
+                          ::io_uring_prep_sendmsg(&sqe,
+                                                  f.native_handle(),
+                                                  &msg,
+                                                  flags);
+                          f.set_flags(sqe);
+                        },
+                        std::forward<CompletionToken>(token));
+  }
+  template<typename MutableBufferSequence,
+           typename CompletionToken>
+  auto initiate_recvmsg(implementation_type& impl,
+                        file f,
+                        MutableBufferSequence mb,
+                        ::sockaddr* addr,
+                        ::socklen_t addr_len,
+                        int flags,
+                        CompletionToken&& token)
+  {
+    return initiate_msg(impl,
+                        mb,
+                        0,
+                        [&](auto&& sqe,
+                            auto&& msg,
+                            auto) noexcept
+                        {
+                          msg.msg_name = addr;
+                          msg.msg_namelen = addr_len;
+                          ::io_uring_prep_recvmsg(&sqe,
+                                                  f.native_handle(),
+                                                  &msg,
+                                                  flags);
+                          f.set_flags(sqe);
+                        },
+                        std::forward<CompletionToken>(token));
+  }
+  template<typename ForwardIterator,
+           typename CompletionToken>
+  auto initiate_sendmsg_batch(implementation_type& impl,
+                              file f,
+                              ForwardIterator begin,
+                              ForwardIterator end,
+                              int flags,
+                              CompletionToken&& token)
+  {
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        rw_signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    completion_handler wrapper(std::move(h),
+                               context().get_executor());
+    auto alloc = wrapper.get_allocator();
+    std::size_t n(std::distance(begin,
+                                end));
+    if (!n) {
+      initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_nop(&sqe);
+               },
+               [w = std::move(wrapper)](auto&&) mutable {
+                 w(boost::system::error_code(),
+                   std::size_t(0));
+               },
+               alloc);
+      return result.get();
+    }
+    using state_type = batch_state<decltype(wrapper)>;
+    auto state = std::allocate_shared<state_type>(alloc,
+                                                  std::move(wrapper),
+                                                  n);
+    //  Each datagram requires its own entry (there is
+    //  no io_uring equivalent of sendmmsg) but they
+    //  all enter the kernel together
+    asio_uring::execution_context::submission_batch batch(context());
+    std::size_t i = 0;
+    try {
+      for (; begin != end; ++begin, ++i) {
+        auto&& datagram = *begin;
+        auto&& addr = datagram.destination();
+        ::socklen_t addr_len = sizeof(addr);
+        boost::asio::const_buffer cb(datagram.buffer());
+        initiate(impl,
+                 1 + msghdr_iovs + to_iovs(addr_len),
+                 [&](auto&& sqe,
+                     auto iovs,
+                     auto) noexcept
+                 {
+                   auto&& msg = to_msghdr(cb,
+                                          1,
+                                          iovs);
+                   auto storage = iovs + 1 + msghdr_iovs;
+                   std::memcpy(storage,
+                               std::addressof(addr),
+                               addr_len);
+                   msg.msg_name = storage;
+                   msg.msg_namelen = addr_len;
+                   ::io_uring_prep_sendmsg(&sqe,
+                                           f.native_handle(),
+                                           &msg,
+                                           flags);
+                   f.set_flags(sqe);
+                 },
+                 [state](auto&& cqe) {
+                   (*state)(cqe.res);
+                 },
+                 alloc);
+      }
+    } catch (...) {
+      state->abandon(n - i);
+      throw;
+    }
+    return result.get();
+  }
+  template<typename Handler>
+  void initiate_recvmsg_multishot(implementation_type& impl,
+                                  file f,
+                                  buffer_ring& ring,
+                                  ::socklen_t addr_len,
+                                  Handler h)
+  {
+    //  The kernel only consults the lengths of the
+    //  name and control data which determine the layout
+    //  of each selected buffer
+    initiate_buffer_select(impl,
+                           msghdr_iovs,
+                           ring,
+                           [&](auto&& sqe,
+                               auto iovs) noexcept
+                           {
+                             auto msg = ::new(static_cast<void*>(iovs)) ::msghdr{};
+                             msg->msg_namelen = addr_len;
+                             ::io_uring_prep_recvmsg_multishot(&sqe,
+                                                               f.native_handle(),
+                                                               msg,
+                                                               0);
+                             f.set_flags(sqe);
+                           },
+                           std::move(h));
+  }
+  void initiate_cancel(implementation_type& impl) {
+    submit_for_each(impl,
+                    [](auto&& sqe,
+                       auto&&,
+                       const void* user_data) noexcept
+                    {
+                      ::io_uring_prep_cancel64(&sqe,
+                                               to_user_data(user_data),
+                                               0);
+                    });
+  }
+  template<typename WaitList,
+           typename CompletionToken>
+  auto initiate_timeout(implementation_type& impl,
+                        std::chrono::nanoseconds t,
+                        unsigned flags,
+                        std::shared_ptr<WaitList> waits,
+                        CompletionToken&& token)
+  {
+    using async_result_type = boost::asio::async_result<std::decay_t<CompletionToken>,
+                                                        poll_signature>;
+    using completion_handler_type = typename async_result_type::completion_handler_type;
+    completion_handler_type h(std::forward<CompletionToken>(token));
+    async_result_type result(h);
+    completion_handler wrapper(std::move(h),
+                               context().get_executor());
+    auto alloc = wrapper.get_allocator();
+    auto ts = to_timespec(t);
+    static_assert(alignof(::__kernel_timespec) <= alignof(::iovec));
+    //  The wait is tracked from the moment the entry is
+    //  prepared (so that it may be removed or updated)
+    //  until just before the handler is invoked. The lock
+    //  is taken before that of the execution context
+    //  since it is held while entries which target
+    //  tracked waits are prepared
+    auto l = waits->lock();
+    waits->reserve();
+    initiate(impl,
+             to_iovs(sizeof(ts)),
+             [&](auto&& sqe,
+                 auto iovs,
+                 auto user_data) noexcept
+             {
+               auto ptr = ::new(static_cast<void*>(iovs)) ::__kernel_timespec(ts);
+               ::io_uring_prep_timeout(&sqe,
+                                       ptr,
+                                       0,
+                                       flags);
+               waits->add(user_data);
+             },
+             [w = std::move(wrapper),
+              waits](auto&& cqe) mutable
+             {
+               waits->remove(reinterpret_cast<const void*>(std::uintptr_t(cqe.user_data)));
+               w(to_timeout_result(cqe.res));
+             },
+             alloc);
+    return result.get();
+  }
+  //  The wait must remain tracked (and therefore its
+  //  completion unreleased) until the entry has been
+  //  prepared (see submit_for_each)
+  void initiate_timeout_remove(const void* user_data) {
+    context().submit_detached([&](auto&& sqe,
+                                  auto&&) noexcept
+                              {
+                                ::io_uring_prep_timeout_remove(&sqe,
+                                                               to_user_data(user_data),
+                                                               0);
+                              });
+  }
+  void initiate_timeout_update(const void* user_data,
+                               std::chrono::nanoseconds t,
+                               unsigned flags)
+  {
+    context().submit_detached([&](auto&& sqe,
+                                  auto&& timeout) noexcept
+                              {
+                                timeout = to_timespec(t);
+                                ::io_uring_prep_timeout_update(&sqe,
+                                                               &timeout,
+                                                               to_user_data(user_data),
+                                                               flags);
+                              });
+  }
   template<typename CompletionToken>
   auto initiate_fsync(implementation_type& impl,
-                      int fd,
+                      file f,
                       bool fdatasync,
                       CompletionToken&& token)
   {
@@ -249,8 +1027,9 @@ public:
                  auto) noexcept
              {
                ::io_uring_prep_fsync(&sqe,
-                                     fd,
+                                     f.native_handle(),
                                      fdatasync ? IORING_FSYNC_DATASYNC : 0);
+               f.set_flags(sqe);
              },
              [w = std::move(wrapper)](auto&& cqe) mutable {
                w(to_fsync_result(cqe.res));
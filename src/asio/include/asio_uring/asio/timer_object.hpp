@@ -0,0 +1,188 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "basic_io_object.hpp"
+#include "execution_context.hpp"
+#include "service.hpp"
+
+namespace asio_uring::asio {
+
+/**
+ *  Derives from \ref basic_io_object and provides
+ *  the functionality common to all timers: Waits are
+ *  `IORING_OP_TIMEOUT` operations which the kernel
+ *  completes once they elapse and which are cancelled
+ *  (`IORING_OP_TIMEOUT_REMOVE`) or rescheduled in place
+ *  (`IORING_TIMEOUT_UPDATE`) by removing or updating
+ *  each pending wait. Neither removals nor updates are
+ *  themselves work or handlers of the execution context.
+ *
+ *  Destroying a timer cancels all pending waits.
+ *
+ *  \sa
+ *    basic_waitable_timer
+ */
+class timer_object : public basic_io_object<execution_context,
+                                            service>
+{
+private:
+  using base = basic_io_object<execution_context,
+                               service>;
+public:
+  timer_object() = delete;
+  timer_object(const timer_object&) = delete;
+  timer_object& operator=(const timer_object&) = delete;
+  /**
+   *  Creates a timer_object which is associated with
+   *  a certain \ref execution_context "execution context".
+   *
+   *  \param [in] ctx
+   *    The \ref execution_context "execution context". This
+   *    reference must remain valid until the end of this
+   *    object's lifetime or the behavior is undefined.
+   */
+  explicit timer_object(execution_context& ctx);
+  /**
+   *  Creates a timer_object by assuming ownership of the
+   *  pending waits of another which is left without any
+   *  (but otherwise usable).
+   *
+   *  \param [in] other
+   *    The timer_object from which to move.
+   */
+  timer_object(timer_object&& other);
+  /**
+   *  Cancels the pending waits of this object and then
+   *  assumes ownership of the pending waits of another
+   *  which is left without any (but otherwise usable).
+   *
+   *  \param [in] rhs
+   *    The timer_object from which to move.
+   *
+   *  \return
+   *    A reference to this object.
+   */
+  timer_object& operator=(timer_object&& rhs);
+  /**
+   *  Cancels all pending waits.
+   */
+  ~timer_object() noexcept;
+  /**
+   *  Cancels all pending waits which thereafter
+   *  complete with `boost::asio::error::operation_aborted`.
+   *
+   *  A wait is pending from its initiation until its
+   *  completion is processed. Therefore a wait which the
+   *  kernel has already completed (i.e. the completion of
+   *  which is queued but has not yet been processed) is
+   *  counted but completes normally nonetheless.
+   *
+   *  \return
+   *    The number of waits which were pending (i.e. an
+   *    upper bound on the number of waits which will
+   *    complete with `boost::asio::error::operation_aborted`).
+   */
+  std::size_t cancel();
+  /**
+   *  Cancels the pending wait which was initiated
+   *  first (see \ref cancel).
+   *
+   *  \return
+   *    The number of waits which were pending (i.e.
+   *    either zero or one).
+   */
+  std::size_t cancel_one();
+protected:
+  /**
+   *  Initiates a wait.
+   *
+   *  \tparam CompletionToken
+   *    A completion token whose associated completion
+   *    handler is invocable with the following signature:
+   *    \code
+   *    void(boost::system::error_code);
+   *    \endcode
+   *    Where the argument is the result of the operation
+   *    (falsy if the wait elapsed).
+   *
+   *  \param [in] t
+   *    Either the time at which the wait elapses (as an
+   *    offset from the epoch of the clock selected by
+   *    `flags`) if `flags` contains `IORING_TIMEOUT_ABS`
+   *    or the duration of the wait otherwise.
+   *  \param [in] flags
+   *    The `IORING_TIMEOUT_*` flags.
+   *  \param [in] token
+   *    The completion token to use to notify the caller
+   *    of completion.
+   *
+   *  \return
+   *    Whatever is appropriate given `CompletionToken`
+   *    and `token`.
+   */
+  template<typename CompletionToken>
+  auto async_wait_for(std::chrono::nanoseconds t,
+                      unsigned flags,
+                      CompletionToken&& token)
+  {
+    return get_service().initiate_timeout(get_implementation(),
+                                          t,
+                                          flags,
+                                          waits_,
+                                          std::forward<CompletionToken>(token));
+  }
+  /**
+   *  Moves all pending waits to a different time without
+   *  completing them.
+   *
+   *  Waits which the kernel has already completed are
+   *  unaffected but are counted if their completions
+   *  have not yet been processed (see \ref cancel).
+   *
+   *  \param [in] t
+   *    As for \ref async_wait_for.
+   *  \param [in] flags
+   *    Either `IORING_TIMEOUT_ABS` or zero. Each wait
+   *    retains the clock with which it was initiated.
+   *
+   *  \return
+   *    The number of waits which were pending (i.e. an
+   *    upper bound on the number of waits which were
+   *    rescheduled).
+   */
+  std::size_t update(std::chrono::nanoseconds t,
+                     unsigned flags);
+private:
+#ifndef ASIO_URING_DOXYGEN_RUNNING
+  //  A wait's completion is released only after it is
+  //  removed from the list and so cannot be reused by
+  //  another operation while the lock is held. All
+  //  members other than lock and remove require that
+  //  the lock be held.
+  class wait_list {
+  public:
+    std::unique_lock<std::mutex> lock();
+    void reserve();
+    void add(const void*) noexcept;
+    void remove(const void*) noexcept;
+    const std::vector<const void*>& get() const noexcept;
+    void clear() noexcept;
+    void pop_front() noexcept;
+  private:
+    std::mutex               m_;
+    std::vector<const void*> v_;
+  };
+#endif
+  std::shared_ptr<wait_list> waits_;
+};
+
+}
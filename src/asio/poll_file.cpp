@@ -2,16 +2,23 @@
 
 #include <system_error>
 #include <utility>
+#include <asio_uring/liburing.hpp>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace asio_uring::asio {
 
 poll_file::poll_file(execution_context& ctx,
-                     fd file)
+                     fd file,
+                     bool fixed)
   : file_object(ctx,
-                std::move(file))
+                std::move(file),
+                fixed),
+    native_    (false),
+    zero_copy_ (false)
 {
   auto flags = ::fcntl(native_handle(),
                        F_GETFL);
@@ -29,6 +36,42 @@ poll_file::poll_file(execution_context& ctx,
                        std::generic_category());
     throw std::system_error(ec);
   }
+  struct ::stat st;
+  if (::fstat(native_handle(),
+              &st) == -1)
+  {
+    std::error_code ec(errno,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  native_ = S_ISSOCK(st.st_mode) &&
+            (ctx.native_handle()->features & IORING_FEAT_FAST_POLL) &&
+            ctx.opcode_supported(IORING_OP_RECV) &&
+            ctx.opcode_supported(IORING_OP_SEND);
+  if (!native_ || !ctx.opcode_supported(IORING_OP_SEND_ZC)) {
+    return;
+  }
+  int domain;
+  ::socklen_t len = sizeof(domain);
+  if (::getsockopt(native_handle(),
+                   SOL_SOCKET,
+                   SO_DOMAIN,
+                   &domain,
+                   &len) == -1)
+  {
+    std::error_code ec(errno,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  zero_copy_ = (domain == AF_INET) || (domain == AF_INET6);
+}
+
+bool poll_file::native() const noexcept {
+  return native_;
+}
+
+bool poll_file::zero_copy() const noexcept {
+  return zero_copy_;
 }
 
 }
@@ -1,12 +1,38 @@
 #include <asio_uring/asio/service.hpp>
 
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <asio_uring/asio/execution_context.hpp>
 #include <asio_uring/execution_context.hpp>
+#include <asio_uring/liburing.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/system/error_code.hpp>
+#include <errno.h>
 
 namespace asio_uring::asio {
 
+service::file::file(int fd,
+                    bool fixed) noexcept
+  : fd_   (fd),
+    fixed_(fixed)
+{}
+
+int service::file::native_handle() const noexcept {
+  return fd_;
+}
+
+bool service::file::fixed() const noexcept {
+  return fixed_;
+}
+
+void service::file::set_flags(::io_uring_sqe& sqe) const noexcept {
+  if (fixed_) {
+    sqe.flags |= IOSQE_FIXED_FILE;
+  }
+}
+
 service::rw_result_type service::to_rw_result(int res) noexcept {
   rw_result_type retr(boost::system::error_code(),
                       0);
@@ -23,7 +49,7 @@ boost::system::error_code service::to_poll_add_result(int res) noexcept {
   if (res > 0) {
     return boost::system::error_code();
   }
-  if (res < 0) {
+  if (res < 0 && res != -ECANCELED) {
     return boost::system::error_code(-res,
                                      boost::system::generic_category());
   }
@@ -42,11 +68,69 @@ boost::system::error_code service::to_fsync_result(int res) noexcept {
   return to_poll_remove_result(res);
 }
 
+boost::system::error_code service::to_multishot_result(int res) noexcept {
+  assert(res < 0);
+  if (res == -ECANCELED) {
+    return make_error_code(boost::asio::error::operation_aborted);
+  }
+  return boost::system::error_code(-res,
+                                   boost::system::generic_category());
+}
+
+std::uint64_t service::to_user_data(const void* ptr) noexcept {
+  std::uint64_t retr;
+  static_assert(sizeof(retr) == sizeof(ptr));
+  std::memcpy(&retr,
+              &ptr,
+              sizeof(retr));
+  return retr;
+}
+
+boost::system::error_code service::to_connect_result(int res) noexcept {
+  if (res == -ECANCELED) {
+    return make_error_code(boost::asio::error::operation_aborted);
+  }
+  return to_poll_remove_result(res);
+}
+
+boost::system::error_code service::to_batch_result(int res) noexcept {
+  return to_connect_result(res);
+}
+
+boost::system::error_code service::to_timeout_result(int res) noexcept {
+  //  A timeout which is not satisfied by a count of
+  //  completions completes with -ETIME once it elapses
+  if (res == -ETIME) {
+    return boost::system::error_code();
+  }
+  return to_connect_result(res);
+}
+
+::__kernel_timespec service::to_timespec(std::chrono::nanoseconds timeout) noexcept {
+  if (timeout < std::chrono::nanoseconds::zero()) {
+    timeout = std::chrono::nanoseconds::zero();
+  }
+  auto sec = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+  ::__kernel_timespec retr{};
+  retr.tv_sec = sec.count();
+  retr.tv_nsec = (timeout - sec).count();
+  return retr;
+}
+
 service::service(boost::asio::execution_context& ctx)
   : asio_uring::service                    (static_cast<asio_uring::asio::execution_context&>(ctx)),
     boost::asio::execution_context::service(ctx)
 {}
 
+service::service(boost::asio::execution_context& ctx,
+                 std::size_t prewarm,
+                 std::size_t high_water_mark)
+  : asio_uring::service                    (static_cast<asio_uring::asio::execution_context&>(ctx),
+                                            prewarm,
+                                            high_water_mark),
+    boost::asio::execution_context::service(ctx)
+{}
+
 execution_context& service::context() const noexcept {
   return static_cast<execution_context&>(asio_uring::service::context());
 }
@@ -1,12 +1,18 @@
 #include <asio_uring/asio/accept_file.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <future>
 #include <optional>
 #include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <asio_uring/asio/execution_context.hpp>
 #include <asio_uring/fd.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/endian/conversion.hpp>
 #include <fcntl.h>
 #include <netinet/in.h>
@@ -166,5 +172,189 @@ TEST_CASE("accept_file binary async_accept",
   CHECK((result & O_NONBLOCK) != 0);
 }
 
+TEST_CASE("accept_file async_accept_multishot",
+          "[accept_file]")
+{
+  fd listen(::socket(AF_INET,
+                     SOCK_STREAM | SOCK_NONBLOCK,
+                     0));
+  ::sockaddr_in addr;
+  std::memset(&addr,
+              0,
+              sizeof(addr));
+  addr.sin_family = AF_INET;
+  std::uint32_t ip = 127;
+  ip <<= 8;
+  ip <<= 8;
+  ip <<= 8;
+  ip |= 1;
+  boost::endian::native_to_big_inplace(ip);
+  addr.sin_addr.s_addr = ip;
+  auto result = ::bind(listen.native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+  REQUIRE(result == 0);
+  ::socklen_t addr_len = sizeof(addr);
+  result = ::getsockname(listen.native_handle(),
+                         reinterpret_cast<::sockaddr*>(&addr),
+                         &addr_len);
+  REQUIRE(result == 0);
+  result = ::listen(listen.native_handle(),
+                    8);
+  REQUIRE(result == 0);
+  std::vector<fd> accepted;
+  std::optional<std::error_code> final;
+  execution_context ctx(10);
+  accept_file accept(ctx,
+                     std::move(listen));
+  accept.async_accept_multishot([&](auto ec,
+                                    auto fd) noexcept
+                                {
+                                  REQUIRE_FALSE(final);
+                                  if (ec) {
+                                    final = ec;
+                                    return;
+                                  }
+                                  accepted.push_back(std::move(fd));
+                                });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  std::vector<fd> connects;
+  for (std::size_t i = 1; i <= 3; ++i) {
+    connects.emplace_back(::socket(AF_INET,
+                                   SOCK_STREAM,
+                                   0));
+    result = ::connect(connects.back().native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+    REQUIRE(result == 0);
+    ctx.restart();
+    handlers = ctx.run_one();
+    CHECK(handlers == 1);
+    REQUIRE(accepted.size() == i);
+    result = ::fcntl(accepted.back().native_handle(),
+                     F_GETFL);
+    REQUIRE(result >= 0);
+    CHECK((result & O_NONBLOCK) != 0);
+  }
+  CHECK_FALSE(final);
+  accept.cancel();
+  ctx.restart();
+  ctx.run();
+  REQUIRE(final);
+  CHECK(*final == make_error_code(boost::asio::error::operation_aborted));
+  CHECK(accepted.size() == 3);
+}
+
+TEST_CASE("accept_file async_accept_multishot cancel from another thread",
+          "[accept_file]")
+{
+  fd listen(::socket(AF_INET,
+                     SOCK_STREAM | SOCK_NONBLOCK,
+                     0));
+  ::sockaddr_in addr;
+  std::memset(&addr,
+              0,
+              sizeof(addr));
+  addr.sin_family = AF_INET;
+  std::uint32_t ip = 127;
+  ip <<= 8;
+  ip <<= 8;
+  ip <<= 8;
+  ip |= 1;
+  boost::endian::native_to_big_inplace(ip);
+  addr.sin_addr.s_addr = ip;
+  auto result = ::bind(listen.native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+  REQUIRE(result == 0);
+  ::socklen_t addr_len = sizeof(addr);
+  result = ::getsockname(listen.native_handle(),
+                         reinterpret_cast<::sockaddr*>(&addr),
+                         &addr_len);
+  REQUIRE(result == 0);
+  result = ::listen(listen.native_handle(),
+                    64);
+  REQUIRE(result == 0);
+  std::atomic<std::size_t> accepted(0);
+  std::atomic<std::size_t> finals(0);
+  std::optional<std::error_code> final;
+  execution_context ctx(64,
+                        0,
+                        2);
+  accept_file accept(ctx,
+                     std::move(listen));
+  accept.async_accept_multishot([&](auto ec,
+                                    auto) noexcept
+                                {
+                                  if (ec) {
+                                    final = ec;
+                                    ++finals;
+                                    return;
+                                  }
+                                  ++accepted;
+                                });
+  //  Connections are still being accepted (and the
+  //  stream may be rearming) when cancel is called so
+  //  if the newly-armed operation escaped cancellation
+  //  run would never return
+  auto f = std::async(std::launch::async,
+                      [&]() { return ctx.run(); });
+  std::vector<fd> connects;
+  for (std::size_t i = 0; i < 32; ++i) {
+    connects.emplace_back(::socket(AF_INET,
+                                   SOCK_STREAM,
+                                   0));
+    result = ::connect(connects.back().native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+    REQUIRE(result == 0);
+  }
+  accept.cancel();
+  auto status = f.wait_for(std::chrono::seconds(10));
+  if (status != std::future_status::ready) {
+    ctx.stop();
+  }
+  f.get();
+  REQUIRE(status == std::future_status::ready);
+  CHECK(finals == 1);
+  REQUIRE(final);
+  CHECK(*final == make_error_code(boost::asio::error::operation_aborted));
+  CHECK(accepted <= 32);
+}
+
+TEST_CASE("accept_file async_accept_multishot cancelled before falling back",
+          "[accept_file]")
+{
+  //  Accepting from a socket which is not listening
+  //  fails with EINVAL as multishot accept does on
+  //  kernels which do not support it
+  fd listen(::socket(AF_INET,
+                     SOCK_STREAM | SOCK_NONBLOCK,
+                     0));
+  std::vector<fd> accepted;
+  std::optional<std::error_code> final;
+  execution_context ctx(10);
+  accept_file accept(ctx,
+                     std::move(listen));
+  accept.async_accept_multishot([&](auto ec,
+                                    auto fd) noexcept
+                                {
+                                  REQUIRE_FALSE(final);
+                                  if (ec) {
+                                    final = ec;
+                                    return;
+                                  }
+                                  accepted.push_back(std::move(fd));
+                                });
+  //  The cancellation finds nothing to cancel since the
+  //  accept has already failed
+  accept.cancel();
+  ctx.run();
+  REQUIRE(final);
+  CHECK(*final == make_error_code(boost::asio::error::operation_aborted));
+  CHECK(accepted.empty());
+}
+
 }
 }
@@ -1,5 +1,6 @@
 #include <asio_uring/asio/async_file.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <optional>
 #include <string>
@@ -13,6 +14,7 @@
 #include <boost/system/error_code.hpp>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <catch2/catch.hpp>
@@ -226,6 +228,57 @@ TEST_CASE("async_file async_write_some_at",
   CHECK(sv == str);
 }
 
+TEST_CASE("async_file fixed async_write_some_at & async_read_some_at",
+          "[async_file]")
+{
+  std::string str("Hello world!");
+  char filename[] = "/tmp/XXXXXX";
+  fd file(::mkstemp(filename));
+  INFO("Temporary file is " << filename);
+  using pair_type = std::pair<std::error_code,
+                              std::size_t>;
+  std::optional<pair_type> a;
+  std::optional<pair_type> b;
+  char buffer[16];
+  execution_context ctx(10);
+  async_file async(ctx,
+                   std::move(file),
+                   true);
+  CHECK(async.fixed());
+  async.async_write_some_at(0,
+                            boost::asio::const_buffer(str.data(),
+                                                      str.size()),
+                            [&](auto ec,
+                                auto bytes_transferred) noexcept
+                            {
+                              a.emplace(ec,
+                                        bytes_transferred);
+                            });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(a);
+  CHECK_FALSE(a->first);
+  CHECK(a->second == str.size());
+  async.async_read_some_at(0,
+                           boost::asio::mutable_buffer(buffer,
+                                                       sizeof(buffer)),
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             b.emplace(ec,
+                                       bytes_transferred);
+                           });
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(b);
+  CHECK_FALSE(b->first);
+  REQUIRE(b->second == str.size());
+  std::string_view sv(buffer,
+                      b->second);
+  CHECK(sv == str);
+}
+
 TEST_CASE("async_file async_write_some_at boost::system::error_code",
           "[async_file]")
 {
@@ -381,5 +434,91 @@ TEST_CASE("async_file get_executor",
   CHECK(async.get_executor() != other_ctx.get_executor());
 }
 
+TEST_CASE("async_file async_write_some_at_fixed & async_read_some_at_fixed",
+          "[async_file]")
+{
+  std::string str("Hello world!");
+  char filename[] = "/tmp/XXXXXX";
+  fd file(::mkstemp(filename));
+  INFO("Temporary file is " << filename);
+  char buffers[2][16] = {};
+  std::copy(str.begin(),
+            str.end(),
+            buffers[0]);
+  ::iovec iovs[2];
+  for (std::size_t i = 0; i < 2; ++i) {
+    iovs[i].iov_base = buffers[i];
+    iovs[i].iov_len = sizeof(buffers[i]);
+  }
+  using pair_type = std::pair<std::error_code,
+                              std::size_t>;
+  std::optional<pair_type> a;
+  std::optional<pair_type> b;
+  execution_context ctx(10);
+  ctx.register_buffers(iovs,
+                       2);
+  async_file async(ctx,
+                   std::move(file));
+  async.async_write_some_at_fixed(0,
+                                  boost::asio::const_buffer(buffers[0],
+                                                            str.size()),
+                                  0,
+                                  [&](auto ec,
+                                      auto bytes_transferred) noexcept
+                                  {
+                                    a.emplace(ec,
+                                              bytes_transferred);
+                                  });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(a);
+  CHECK_FALSE(a->first);
+  CHECK(a->second == str.size());
+  async.async_read_some_at_fixed(6,
+                                 boost::asio::mutable_buffer(buffers[1] + 1,
+                                                             6),
+                                 1,
+                                 [&](auto ec,
+                                     auto bytes_transferred) noexcept
+                                 {
+                                   b.emplace(ec,
+                                             bytes_transferred);
+                                 });
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(b);
+  CHECK_FALSE(b->first);
+  CHECK(b->second == 6);
+  CHECK(std::string_view(buffers[1] + 1,
+                         6) == "world!");
+}
+
+TEST_CASE("async_file async_read_some_at_fixed unregistered",
+          "[async_file]")
+{
+  char filename[] = "/tmp/XXXXXX";
+  fd file(::mkstemp(filename));
+  INFO("Temporary file is " << filename);
+  char buffer[16];
+  std::optional<std::error_code> a;
+  execution_context ctx(10);
+  async_file async(ctx,
+                   std::move(file));
+  async.async_read_some_at_fixed(0,
+                                 boost::asio::mutable_buffer(buffer,
+                                                             sizeof(buffer)),
+                                 0,
+                                 [&](auto ec,
+                                     auto) noexcept
+                                 {
+                                   a = ec;
+                                 });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(a);
+  CHECK(*a);
+}
+
 }
 }
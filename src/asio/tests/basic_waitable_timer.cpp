@@ -0,0 +1,154 @@
+#include <asio_uring/asio/basic_waitable_timer.hpp>
+
+#include <chrono>
+#include <optional>
+#include <asio_uring/asio/execution_context.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::asio::tests {
+namespace {
+
+//  A clock which is not known to the timer and for
+//  which waits are therefore relative
+class relative_clock {
+public:
+  using duration = std::chrono::steady_clock::duration;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<relative_clock,
+                                             duration>;
+  static constexpr bool is_steady = true;
+  static time_point now() noexcept {
+    return time_point(std::chrono::steady_clock::now().time_since_epoch());
+  }
+};
+
+TEST_CASE("basic_waitable_timer async_wait",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::milliseconds(50));
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  CHECK_FALSE(ec);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  CHECK(steady_timer::clock_type::now() >= timer.expiry());
+}
+
+TEST_CASE("basic_waitable_timer async_wait expired",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx);
+  CHECK(timer.expiry() == steady_timer::time_point());
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+}
+
+TEST_CASE("basic_waitable_timer expires_after",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::hours(1));
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  auto cancelled = timer.expires_after(std::chrono::milliseconds(10));
+  CHECK(cancelled == 1);
+  ctx.restart();
+  handlers = ctx.run();
+  //  The IORING_OP_TIMEOUT_REMOVE is not counted
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK(*ec == boost::asio::error::operation_aborted);
+  ec = std::nullopt;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  CHECK(timer.expires_after(std::chrono::hours(1)) == 0);
+}
+
+TEST_CASE("basic_waitable_timer reschedule_after",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::hours(1));
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  auto start = steady_timer::clock_type::now();
+  auto rescheduled = timer.reschedule_after(std::chrono::milliseconds(50));
+  CHECK(rescheduled == 1);
+  ctx.restart();
+  handlers = ctx.run();
+  //  The update is not counted
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  CHECK((steady_timer::clock_type::now() - start) >= std::chrono::milliseconds(50));
+  CHECK(timer.reschedule_after(std::chrono::hours(1)) == 0);
+}
+
+TEST_CASE("basic_waitable_timer system_timer",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  system_timer timer(ctx,
+                     std::chrono::milliseconds(10));
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  CHECK(system_timer::clock_type::now() >= timer.expiry());
+}
+
+TEST_CASE("basic_waitable_timer relative",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  basic_waitable_timer<relative_clock> timer(ctx,
+                                             std::chrono::milliseconds(10));
+  std::optional<boost::system::error_code> ec;
+  timer.async_wait([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  CHECK(relative_clock::now() >= timer.expiry());
+}
+
+TEST_CASE("basic_waitable_timer wait",
+          "[basic_waitable_timer]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::milliseconds(10));
+  timer.wait();
+  CHECK(steady_timer::clock_type::now() >= timer.expiry());
+}
+
+}
+}
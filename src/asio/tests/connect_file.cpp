@@ -1,6 +1,7 @@
 #include <asio_uring/asio/connect_file.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -9,6 +10,7 @@
 #include <utility>
 #include <asio_uring/asio/execution_context.hpp>
 #include <asio_uring/fd.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/endian/conversion.hpp>
 #include <errno.h>
 #include <fcntl.h>
@@ -120,5 +122,112 @@ TEST_CASE("connect_file async_connect bad destination",
   CHECK(*ec);
 }
 
+::sockaddr_in listening(fd& listen,
+                        int backlog)
+{
+  listen = fd(::socket(AF_INET,
+                       SOCK_STREAM,
+                       0));
+  ::sockaddr_in addr;
+  std::memset(&addr,
+              0,
+              sizeof(addr));
+  addr.sin_family = AF_INET;
+  std::uint32_t ip = 127;
+  ip <<= 8;
+  ip <<= 8;
+  ip <<= 8;
+  ip |= 1;
+  boost::endian::native_to_big_inplace(ip);
+  addr.sin_addr.s_addr = ip;
+  auto result = ::bind(listen.native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+  REQUIRE(result == 0);
+  ::socklen_t addr_len = sizeof(addr);
+  result = ::getsockname(listen.native_handle(),
+                         reinterpret_cast<::sockaddr*>(&addr),
+                         &addr_len);
+  REQUIRE(result == 0);
+  REQUIRE(addr.sin_port != 0);
+  result = ::listen(listen.native_handle(),
+                    backlog);
+  REQUIRE(result == 0);
+  return addr;
+}
+
+fd non_blocking_socket() {
+  fd retr(::socket(AF_INET,
+                   SOCK_STREAM,
+                   0));
+  auto result = ::fcntl(retr.native_handle(),
+                        F_GETFL);
+  REQUIRE(result >= 0);
+  result |= O_NONBLOCK;
+  result = ::fcntl(retr.native_handle(),
+                   F_SETFL,
+                   result);
+  REQUIRE(result == 0);
+  return retr;
+}
+
+TEST_CASE("connect_file async_connect timeout",
+          "[connect_file]")
+{
+  fd listen;
+  auto addr = listening(listen,
+                        0);
+  //  Fill the accept queue so that further handshakes
+  //  are dropped
+  fd queued(::socket(AF_INET,
+                     SOCK_STREAM,
+                     0));
+  auto result = ::connect(queued.native_handle(),
+                          reinterpret_cast<const ::sockaddr*>(&addr),
+                          sizeof(addr));
+  REQUIRE(result == 0);
+  std::optional<boost::system::error_code> ec;
+  execution_context ctx(10);
+  connect_file poll(ctx,
+                    non_blocking_socket());
+  auto start = std::chrono::steady_clock::now();
+  poll.async_connect(addr,
+                     std::chrono::milliseconds(50),
+                     [&](auto e) noexcept { ec = e; });
+  CHECK_FALSE(ec);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK(*ec == boost::asio::error::timed_out);
+  CHECK((std::chrono::steady_clock::now() - start) >= std::chrono::milliseconds(50));
+}
+
+TEST_CASE("connect_file async_connect timeout not reached",
+          "[connect_file]")
+{
+  fd listen;
+  auto addr = listening(listen,
+                        1);
+  std::optional<boost::system::error_code> ec;
+  execution_context ctx(10);
+  connect_file poll(ctx,
+                    non_blocking_socket());
+  poll.async_connect(addr,
+                     std::chrono::seconds(10),
+                     [&](auto e) noexcept { ec = e; });
+  CHECK_FALSE(ec);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  ::sockaddr_in peer;
+  ::socklen_t peer_len = sizeof(peer);
+  auto result = ::getpeername(poll.native_handle(),
+                              reinterpret_cast<::sockaddr*>(&peer),
+                              &peer_len);
+  CHECK(result == 0);
+  CHECK(peer.sin_port == addr.sin_port);
+}
+
 }
 }
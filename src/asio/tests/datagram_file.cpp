@@ -0,0 +1,279 @@
+#include <asio_uring/asio/datagram_file.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <asio_uring/asio/execution_context.hpp>
+#include <asio_uring/buffer_ring.hpp>
+#include <asio_uring/fd.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/endian/conversion.hpp>
+#include <boost/system/error_code.hpp>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::asio::tests {
+namespace {
+
+fd udp_socket(::sockaddr_in& addr) {
+  fd retr(::socket(AF_INET,
+                   SOCK_DGRAM,
+                   0));
+  std::memset(&addr,
+              0,
+              sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = boost::endian::native_to_big(std::uint32_t(INADDR_LOOPBACK));
+  auto result = ::bind(retr.native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+  REQUIRE(result == 0);
+  ::socklen_t addr_len = sizeof(addr);
+  result = ::getsockname(retr.native_handle(),
+                         reinterpret_cast<::sockaddr*>(&addr),
+                         &addr_len);
+  REQUIRE(result == 0);
+  REQUIRE(addr.sin_port != 0);
+  return retr;
+}
+
+TEST_CASE("datagram_file async_send_to & async_receive_from",
+          "[datagram_file]")
+{
+  ::sockaddr_in a_addr;
+  ::sockaddr_in b_addr;
+  auto a = udp_socket(a_addr);
+  auto b = udp_socket(b_addr);
+  execution_context ctx(10);
+  datagram_file sender(ctx,
+                       std::move(a));
+  datagram_file receiver(ctx,
+                         std::move(b));
+  std::array<char,
+             32> buffer{};
+  ::sockaddr_in from{};
+  using pair_type = std::pair<boost::system::error_code,
+                              std::size_t>;
+  std::optional<pair_type> received;
+  receiver.async_receive_from(boost::asio::buffer(buffer),
+                              from,
+                              [&](auto ec,
+                                  auto bytes_transferred)
+                              {
+                                received.emplace(ec,
+                                                 bytes_transferred);
+                              });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  CHECK_FALSE(received);
+  std::string_view hello("Hello ");
+  std::string_view world("world!");
+  std::array<boost::asio::const_buffer,
+             2> bufs{boost::asio::buffer(hello),
+                     boost::asio::buffer(world)};
+  std::optional<pair_type> sent;
+  sender.async_send_to(bufs,
+                       b_addr,
+                       [&](auto ec,
+                           auto bytes_transferred)
+                       {
+                         sent.emplace(ec,
+                                      bytes_transferred);
+                       });
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 2);
+  REQUIRE(sent);
+  CHECK_FALSE(sent->first);
+  CHECK(sent->second == 12);
+  REQUIRE(received);
+  CHECK_FALSE(received->first);
+  REQUIRE(received->second == 12);
+  CHECK(std::string_view(buffer.data(),
+                         received->second) == "Hello world!");
+  CHECK(from.sin_family == AF_INET);
+  CHECK(from.sin_port == a_addr.sin_port);
+}
+
+TEST_CASE("datagram_file async_send_to_batch",
+          "[datagram_file]")
+{
+  ::sockaddr_in a_addr;
+  ::sockaddr_in b_addr;
+  auto a = udp_socket(a_addr);
+  fd b = udp_socket(b_addr);
+  execution_context ctx(4);
+  datagram_file sender(ctx,
+                       std::move(a));
+  //  More datagrams than there are entries in the
+  //  submission queue
+  std::string_view strs[] = {"a",
+                             "bc",
+                             "def",
+                             "ghij",
+                             "klmno",
+                             "pqrstu"};
+  std::vector<outgoing_datagram<::sockaddr_in>> datagrams;
+  for (auto sv : strs) {
+    datagrams.emplace_back(boost::asio::buffer(sv),
+                           b_addr);
+  }
+  std::optional<boost::system::error_code> ec;
+  std::optional<std::size_t> n;
+  sender.async_send_to_batch(datagrams,
+                             [&](auto e,
+                                 auto sent)
+                             {
+                               ec = e;
+                               n = sent;
+                             });
+  datagrams.clear();
+  auto handlers = ctx.run();
+  CHECK(handlers == 6);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  REQUIRE(n);
+  CHECK(*n == 6);
+  std::vector<std::string> received;
+  for (std::size_t i = 0; i < 6; ++i) {
+    char buffer[16];
+    auto read = ::recv(b.native_handle(),
+                       buffer,
+                       sizeof(buffer),
+                       MSG_DONTWAIT);
+    REQUIRE(read > 0);
+    received.emplace_back(buffer,
+                          read);
+  }
+  std::sort(received.begin(),
+            received.end());
+  CHECK(received == std::vector<std::string>(std::begin(strs),
+                                             std::end(strs)));
+}
+
+TEST_CASE("datagram_file async_send_to_batch empty",
+          "[datagram_file]")
+{
+  ::sockaddr_in addr;
+  execution_context ctx(4);
+  datagram_file sender(ctx,
+                       udp_socket(addr));
+  std::vector<outgoing_datagram<::sockaddr_in>> datagrams;
+  std::optional<boost::system::error_code> ec;
+  std::optional<std::size_t> n;
+  sender.async_send_to_batch(datagrams,
+                             [&](auto e,
+                                 auto sent)
+                             {
+                               ec = e;
+                               n = sent;
+                             });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+  REQUIRE(n);
+  CHECK(*n == 0);
+}
+
+TEST_CASE("datagram_file async_receive_from_multishot",
+          "[datagram_file]")
+{
+  ::sockaddr_in a_addr;
+  ::sockaddr_in b_addr;
+  fd a = udp_socket(a_addr);
+  auto b = udp_socket(b_addr);
+  execution_context ctx(10);
+  constexpr std::size_t header = sizeof(::io_uring_recvmsg_out) + sizeof(::sockaddr_in);
+  buffer_ring ring(ctx,
+                   0,
+                   2,
+                   header + 4);
+  //  Datagrams must be released before the ring is
+  //  destroyed
+  std::vector<received_datagram<::sockaddr_in>> datagrams;
+  std::optional<boost::system::error_code> final;
+  auto func = [&](auto ec,
+                  auto datagram)
+              {
+                REQUIRE_FALSE(final);
+                if (ec) {
+                  CHECK_FALSE(datagram);
+                  final = ec;
+                  return;
+                }
+                datagrams.push_back(std::move(datagram));
+              };
+  datagram_file receiver(ctx,
+                         std::move(b));
+  receiver.async_receive_from_multishot<::sockaddr_in>(ring,
+                                                       func);
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  auto send = [&](std::string_view sv) {
+    auto written = ::sendto(a.native_handle(),
+                            sv.data(),
+                            sv.size(),
+                            0,
+                            reinterpret_cast<const ::sockaddr*>(&b_addr),
+                            sizeof(b_addr));
+    REQUIRE(written == sv.size());
+  };
+  send("abc");
+  ctx.restart();
+  handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  REQUIRE(datagrams.size() == 1);
+  REQUIRE(datagrams.back());
+  auto data = datagrams.back().data();
+  CHECK(std::string_view(static_cast<const char*>(data.data()),
+                         data.size()) == "abc");
+  CHECK_FALSE(datagrams.back().truncated());
+  CHECK(datagrams.back().sender().sin_port == a_addr.sin_port);
+  send("defgh");
+  ctx.restart();
+  handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  REQUIRE(datagrams.size() == 2);
+  data = datagrams.back().data();
+  CHECK(std::string_view(static_cast<const char*>(data.data()),
+                         data.size()) == "defg");
+  CHECK(datagrams.back().truncated());
+  CHECK_FALSE(final);
+  send("i");
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(final);
+  CHECK(final->value() == ENOBUFS);
+  datagrams.clear();
+  final = std::nullopt;
+  receiver.async_receive_from_multishot<::sockaddr_in>(ring,
+                                                       func);
+  ctx.restart();
+  handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  REQUIRE(datagrams.size() == 1);
+  data = datagrams.back().data();
+  CHECK(std::string_view(static_cast<const char*>(data.data()),
+                         data.size()) == "i");
+  receiver.cancel();
+  ctx.restart();
+  ctx.run();
+  REQUIRE(final);
+  CHECK(*final == boost::asio::error::operation_aborted);
+  datagrams.clear();
+}
+
+}
+}
@@ -0,0 +1,29 @@
+#include <asio_uring/asio/execution_context_pool.hpp>
+
+#include <cstddef>
+#include <asio_uring/asio/service.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::asio::tests {
+namespace {
+
+TEST_CASE("execution_context_pool use_service",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(2,
+                              10);
+  auto&& a = boost::asio::use_service<service>(pool.context(0));
+  auto&& b = boost::asio::use_service<service>(pool.context(1));
+  CHECK(&a != &b);
+  std::size_t invoked = 0;
+  boost::asio::post(pool.get_executor(),
+                    [&]() { ++invoked; });
+  CHECK(pool.run() == 1);
+  CHECK(invoked == 1);
+}
+
+}
+}
@@ -25,6 +25,7 @@ TEST_CASE("file_object native_handle",
   file_object obj(ctx,
                   std::move(read));
   CHECK(obj.native_handle() == pipes[0]);
+  CHECK_FALSE(obj.fixed());
 }
 
 class derived : public file_object {
@@ -34,6 +35,7 @@ public:
   using file_object::wrap_token;
   using file_object::reset;
   using file_object::outstanding;
+  using file_object::file_handle;
 };
 
 TEST_CASE("file_object outstanding & wrap_handler",
@@ -147,5 +149,33 @@ TEST_CASE("file_object outstanding & wrap_token",
   CHECK(*outstanding == 1);
 }
 
+TEST_CASE("file_object fixed",
+          "[file_object]")
+{
+  int pipes[2];
+  auto result = ::pipe(pipes);
+  REQUIRE(result == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  execution_context ctx(10);
+  derived obj(ctx,
+              std::move(write),
+              true);
+  CHECK(obj.fixed());
+  CHECK(obj.native_handle() == pipes[1]);
+  auto f = obj.file_handle();
+  CHECK(f.fixed());
+  int index = f.native_handle();
+  CHECK(index != pipes[1]);
+  auto wrapped = obj.wrap_handler([]() noexcept {});
+  obj.reset();
+  int other = ctx.register_file(read.native_handle());
+  CHECK(other != index);
+  ctx.unregister_file(other);
+  wrapped();
+  other = ctx.register_file(read.native_handle());
+  CHECK(other == index);
+}
+
 }
 }
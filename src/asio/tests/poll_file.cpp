@@ -1,18 +1,25 @@
 #include <asio_uring/asio/poll_file.hpp>
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
 #include <optional>
+#include <string_view>
 #include <system_error>
 #include <utility>
 #include <vector>
 #include <asio_uring/asio/execution_context.hpp>
+#include <asio_uring/buffer_ring.hpp>
 #include <asio_uring/fd.hpp>
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
 #include <boost/system/error_code.hpp>
 #include <errno.h>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include <catch2/catch.hpp>
@@ -49,6 +56,32 @@ TEST_CASE("poll_file async_poll_in",
   CHECK_FALSE(*ec);
 }
 
+TEST_CASE("poll_file fixed async_poll_in",
+          "[poll_file]")
+{
+  int pipes[2];
+  auto result = ::pipe(pipes);
+  REQUIRE(result == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  std::optional<std::error_code> ec;
+  execution_context ctx(10);
+  poll_file poll(ctx,
+                 std::move(read),
+                 true);
+  CHECK(poll.fixed());
+  char c = 'A';
+  auto written = ::write(write.native_handle(),
+                         &c,
+                         sizeof(c));
+  REQUIRE(written == 1);
+  poll.async_poll_in([&](auto e) noexcept { ec = e; });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK_FALSE(*ec);
+}
+
 TEST_CASE("poll_file async_poll_out",
           "[poll_file]")
 {
@@ -105,6 +138,7 @@ TEST_CASE("poll_file async_read_some",
   execution_context ctx(10);
   poll_file poll(ctx,
                  std::move(read));
+  CHECK_FALSE(poll.native());
   char buffer[16];
   poll.async_read_some(boost::asio::buffer(buffer),
                        [&](auto ec,
@@ -362,6 +396,399 @@ TEST_CASE("poll_file async_write_some empty buffer sequence",
   CHECK(o->second == 0);
 }
 
+TEST_CASE("poll_file native async_read_some",
+          "[poll_file]")
+{
+  int sockets[2];
+  auto result = ::socketpair(AF_UNIX,
+                             SOCK_STREAM,
+                             0,
+                             sockets);
+  REQUIRE(result == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  using pair_type = std::pair<std::error_code,
+                              std::size_t>;
+  std::optional<pair_type> o;
+  execution_context ctx(10);
+  poll_file poll(ctx,
+                 std::move(local));
+  CHECK(poll.native());
+  char buffer[16];
+  std::array<boost::asio::mutable_buffer, 2> bufs{boost::asio::mutable_buffer(),
+                                                  boost::asio::buffer(buffer)};
+  poll.async_read_some(bufs,
+                       [&](auto ec,
+                           auto bytes_transferred) noexcept
+                       {
+                         o.emplace(ec,
+                                   bytes_transferred);
+                       });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  CHECK_FALSE(o);
+  std::string_view sv("Hello world!");
+  auto written = ::write(remote.native_handle(),
+                         sv.data(),
+                         sv.size());
+  REQUIRE(written == sv.size());
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(o);
+  REQUIRE_FALSE(o->first);
+  REQUIRE(o->second == sv.size());
+  std::string_view sv2(buffer,
+                       o->second);
+  CHECK(sv == sv2);
+  o = std::nullopt;
+  remote = fd();
+  poll.async_read_some(boost::asio::buffer(buffer),
+                       [&](auto ec,
+                           auto bytes_transferred) noexcept
+                       {
+                         o.emplace(ec,
+                                   bytes_transferred);
+                       });
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(o);
+  CHECK_FALSE(o->first);
+  CHECK(o->second == 0);
+}
+
+TEST_CASE("poll_file native async_write_some",
+          "[poll_file]")
+{
+  int sockets[2];
+  auto result = ::socketpair(AF_UNIX,
+                             SOCK_STREAM,
+                             0,
+                             sockets);
+  REQUIRE(result == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  using pair_type = std::pair<std::error_code,
+                              std::size_t>;
+  std::optional<pair_type> o;
+  execution_context ctx(10);
+  poll_file poll(ctx,
+                 std::move(local),
+                 true);
+  CHECK(poll.native());
+  std::string_view sv("Hello world!");
+  auto func = [&](auto ec,
+                  auto bytes_transferred) noexcept
+              {
+                o.emplace(ec,
+                          bytes_transferred);
+              };
+  poll.async_write_some(boost::asio::buffer(sv.data(),
+                                            sv.size()),
+                        func);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(o);
+  REQUIRE_FALSE(o->first);
+  REQUIRE(o->second == sv.size());
+  char buffer[16];
+  auto bytes = ::read(remote.native_handle(),
+                      buffer,
+                      sizeof(buffer));
+  REQUIRE(bytes == sv.size());
+  CHECK(std::string_view(buffer,
+                         bytes) == sv);
+  o = std::nullopt;
+  remote = fd();
+  poll.async_write_some(boost::asio::buffer(sv.data(),
+                                            sv.size()),
+                        func);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(o);
+  CHECK(o->first.value() == EPIPE);
+}
+
+std::pair<fd,
+          fd> tcp_socketpair()
+{
+  fd listen(::socket(AF_INET,
+                     SOCK_STREAM,
+                     0));
+  REQUIRE(listen.native_handle() >= 0);
+  ::sockaddr_in addr;
+  std::memset(&addr,
+              0,
+              sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  auto result = ::bind(listen.native_handle(),
+                       reinterpret_cast<const ::sockaddr*>(&addr),
+                       sizeof(addr));
+  REQUIRE(result == 0);
+  ::socklen_t addr_len = sizeof(addr);
+  result = ::getsockname(listen.native_handle(),
+                         reinterpret_cast<::sockaddr*>(&addr),
+                         &addr_len);
+  REQUIRE(result == 0);
+  result = ::listen(listen.native_handle(),
+                    1);
+  REQUIRE(result == 0);
+  fd connect(::socket(AF_INET,
+                      SOCK_STREAM,
+                      0));
+  REQUIRE(connect.native_handle() >= 0);
+  result = ::connect(connect.native_handle(),
+                     reinterpret_cast<const ::sockaddr*>(&addr),
+                     sizeof(addr));
+  REQUIRE(result == 0);
+  fd accepted(::accept(listen.native_handle(),
+                       nullptr,
+                       nullptr));
+  REQUIRE(accepted.native_handle() >= 0);
+  return std::pair(std::move(connect),
+                   std::move(accepted));
+}
+
+TEST_CASE("poll_file async_write_some_zc",
+          "[poll_file]")
+{
+  auto [local, remote] = tcp_socketpair();
+  using pair_type = std::pair<boost::system::error_code,
+                              std::size_t>;
+  std::optional<pair_type> sent;
+  std::optional<pair_type> o;
+  execution_context ctx(10);
+  poll_file poll(ctx,
+                 std::move(local));
+  REQUIRE(poll.native());
+  CHECK(poll.zero_copy());
+  std::vector<char> buffer(1 << 16);
+  for (std::size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = char(i);
+  }
+  poll.async_write_some_zc(boost::asio::buffer(buffer),
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             CHECK_FALSE(o);
+                             sent.emplace(ec,
+                                          bytes_transferred);
+                           },
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             o.emplace(ec,
+                                       bytes_transferred);
+                           });
+  ctx.run();
+  REQUIRE(sent);
+  REQUIRE(o);
+  CHECK(*sent == *o);
+  REQUIRE_FALSE(o->first);
+  REQUIRE(o->second != 0);
+  REQUIRE(o->second <= buffer.size());
+  std::vector<char> received(o->second);
+  std::size_t read = 0;
+  while (read != received.size()) {
+    auto bytes = ::read(remote.native_handle(),
+                        received.data() + read,
+                        received.size() - read);
+    REQUIRE(bytes > 0);
+    read += bytes;
+  }
+  CHECK(std::equal(received.begin(),
+                   received.end(),
+                   buffer.begin()));
+  sent = std::nullopt;
+  o = std::nullopt;
+  //  Without a sent handler
+  poll.async_write_some_zc(boost::asio::buffer(buffer.data(),
+                                               16),
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             o.emplace(ec,
+                                       bytes_transferred);
+                           });
+  ctx.restart();
+  auto handlers = ctx.run();
+  CHECK(handlers == 2);
+  REQUIRE(o);
+  REQUIRE_FALSE(o->first);
+  CHECK(o->second == 16);
+}
+
+TEST_CASE("poll_file async_write_some_zc fallback",
+          "[poll_file]")
+{
+  int sockets[2];
+  auto result = ::socketpair(AF_UNIX,
+                             SOCK_STREAM,
+                             0,
+                             sockets);
+  REQUIRE(result == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  using pair_type = std::pair<boost::system::error_code,
+                              std::size_t>;
+  std::optional<pair_type> sent;
+  std::optional<pair_type> o;
+  execution_context ctx(10);
+  poll_file poll(ctx,
+                 std::move(local));
+  CHECK_FALSE(poll.zero_copy());
+  std::string_view sv("Hello world!");
+  poll.async_write_some_zc(boost::asio::buffer(sv.data(),
+                                               sv.size()),
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             CHECK_FALSE(o);
+                             sent.emplace(ec,
+                                          bytes_transferred);
+                           },
+                           [&](auto ec,
+                               auto bytes_transferred) noexcept
+                           {
+                             o.emplace(ec,
+                                       bytes_transferred);
+                           });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(sent);
+  REQUIRE(o);
+  CHECK(*sent == *o);
+  REQUIRE_FALSE(o->first);
+  REQUIRE(o->second == sv.size());
+  char buffer[16];
+  auto bytes = ::read(remote.native_handle(),
+                      buffer,
+                      sizeof(buffer));
+  REQUIRE(bytes == sv.size());
+  CHECK(std::string_view(buffer,
+                         bytes) == sv);
+}
+
+TEST_CASE("poll_file async_receive_multishot",
+          "[poll_file]")
+{
+  int sockets[2];
+  auto result = ::socketpair(AF_UNIX,
+                             SOCK_STREAM,
+                             0,
+                             sockets);
+  REQUIRE(result == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  execution_context ctx(10);
+  buffer_ring ring(ctx,
+                   0,
+                   2,
+                   16);
+  //  Leases must be released before the ring is
+  //  destroyed
+  std::vector<buffer_ring::lease> leases;
+  std::optional<boost::system::error_code> final;
+  auto func = [&](auto ec,
+                  auto lease)
+              {
+                REQUIRE_FALSE(final);
+                if (ec) {
+                  CHECK_FALSE(lease);
+                  final = ec;
+                  return;
+                }
+                leases.push_back(std::move(lease));
+              };
+  poll_file poll(ctx,
+                 std::move(local));
+  poll.async_receive_multishot(ring,
+                               func);
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  std::string_view strs[] = {"abc",
+                             "defg"};
+  for (auto sv : strs) {
+    auto written = ::write(remote.native_handle(),
+                           sv.data(),
+                           sv.size());
+    REQUIRE(written == sv.size());
+    ctx.restart();
+    handlers = ctx.run_one();
+    CHECK(handlers == 1);
+    REQUIRE(leases.back());
+    CHECK(std::string_view(static_cast<const char*>(leases.back().data()),
+                           leases.back().size()) == sv);
+  }
+  REQUIRE(leases.size() == 2);
+  CHECK_FALSE(final);
+  auto written = ::write(remote.native_handle(),
+                         "h",
+                         1);
+  REQUIRE(written == 1);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(final);
+  CHECK(final->value() == ENOBUFS);
+  leases.clear();
+  final = std::nullopt;
+  poll.async_receive_multishot(ring,
+                               func);
+  ctx.restart();
+  handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  REQUIRE(leases.size() == 1);
+  CHECK(std::string_view(static_cast<const char*>(leases.back().data()),
+                         leases.back().size()) == "h");
+  remote = fd();
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(final);
+  CHECK(*final == boost::asio::error::eof);
+}
+
+TEST_CASE("poll_file async_receive_multishot cancel",
+          "[poll_file]")
+{
+  int sockets[2];
+  auto result = ::socketpair(AF_UNIX,
+                             SOCK_STREAM,
+                             0,
+                             sockets);
+  REQUIRE(result == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  std::optional<boost::system::error_code> final;
+  execution_context ctx(10);
+  buffer_ring ring(ctx,
+                   0,
+                   2,
+                   16);
+  poll_file poll(ctx,
+                 std::move(local));
+  poll.async_receive_multishot(ring,
+                               [&](auto ec,
+                                   auto)
+                               {
+                                 REQUIRE(ec);
+                                 final = ec;
+                               });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  poll.cancel();
+  ctx.restart();
+  //  The cancellation itself is not counted
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(final);
+  CHECK(*final == boost::asio::error::operation_aborted);
+}
+
 TEST_CASE("poll_file async_read_some boost::system::error_code",
           "[poll_file]")
 {
@@ -616,5 +616,15 @@ TEST_CASE("service initiate_fsync bad fd",
                                          boost::system::generic_category()));
 }
 
+TEST_CASE("service make_service prewarm",
+          "[service]")
+{
+  execution_context ctx(100);
+  auto&& svc = boost::asio::make_service<service>(ctx,
+                                                  64);
+  CHECK(svc.capacity() >= 64);
+  CHECK(&boost::asio::use_service<service>(ctx) == &svc);
+}
+
 }
 }
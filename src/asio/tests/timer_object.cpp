@@ -0,0 +1,113 @@
+#include <asio_uring/asio/timer_object.hpp>
+
+#include <chrono>
+#include <optional>
+#include <utility>
+#include <asio_uring/asio/basic_waitable_timer.hpp>
+#include <asio_uring/asio/execution_context.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::asio::tests {
+namespace {
+
+TEST_CASE("timer_object cancel",
+          "[timer_object]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::hours(1));
+  std::optional<boost::system::error_code> a;
+  std::optional<boost::system::error_code> b;
+  timer.async_wait([&](auto e) noexcept { a = e; });
+  timer.async_wait([&](auto e) noexcept { b = e; });
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  CHECK(timer.cancel() == 2);
+  CHECK(timer.cancel() == 0);
+  ctx.restart();
+  handlers = ctx.run();
+  //  The IORING_OP_TIMEOUT_REMOVE operations are not
+  //  counted
+  CHECK(handlers == 2);
+  REQUIRE(a);
+  CHECK(*a == boost::asio::error::operation_aborted);
+  REQUIRE(b);
+  CHECK(*b == boost::asio::error::operation_aborted);
+}
+
+TEST_CASE("timer_object cancel_one",
+          "[timer_object]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx,
+                     std::chrono::hours(1));
+  std::optional<boost::system::error_code> a;
+  std::optional<boost::system::error_code> b;
+  timer.async_wait([&](auto e) noexcept { a = e; });
+  timer.async_wait([&](auto e) noexcept { b = e; });
+  CHECK(timer.cancel_one() == 1);
+  auto handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  REQUIRE(a);
+  CHECK(*a == boost::asio::error::operation_aborted);
+  CHECK_FALSE(b);
+  CHECK(timer.cancel_one() == 1);
+  CHECK(timer.cancel_one() == 0);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(b);
+  CHECK(*b == boost::asio::error::operation_aborted);
+}
+
+TEST_CASE("timer_object cancel within handler",
+          "[timer_object]")
+{
+  execution_context ctx(10);
+  steady_timer timer(ctx);
+  std::optional<std::size_t> cancelled;
+  timer.async_wait([&](auto) { cancelled = timer.cancel(); });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cancelled);
+  CHECK(*cancelled == 0);
+}
+
+TEST_CASE("timer_object destroy",
+          "[timer_object]")
+{
+  execution_context ctx(10);
+  std::optional<boost::system::error_code> ec;
+  {
+    steady_timer timer(ctx,
+                       std::chrono::hours(1));
+    timer.async_wait([&](auto e) noexcept { ec = e; });
+  }
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK(*ec == boost::asio::error::operation_aborted);
+}
+
+TEST_CASE("timer_object move",
+          "[timer_object]")
+{
+  execution_context ctx(10);
+  steady_timer a(ctx,
+                 std::chrono::hours(1));
+  std::optional<boost::system::error_code> ec;
+  a.async_wait([&](auto e) noexcept { ec = e; });
+  steady_timer b(std::move(a));
+  CHECK(a.cancel() == 0);
+  CHECK(b.cancel() == 1);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(ec);
+  CHECK(*ec == boost::asio::error::operation_aborted);
+}
+
+}
+}
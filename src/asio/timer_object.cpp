@@ -0,0 +1,116 @@
+#include <asio_uring/asio/timer_object.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <asio_uring/asio/execution_context.hpp>
+#include <asio_uring/asio/service.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace asio_uring::asio {
+
+std::unique_lock<std::mutex> timer_object::wait_list::lock() {
+  return std::unique_lock<std::mutex>(m_);
+}
+
+void timer_object::wait_list::reserve() {
+  v_.reserve(v_.size() + 1);
+}
+
+void timer_object::wait_list::add(const void* ptr) noexcept {
+  assert(v_.size() < v_.capacity());
+  v_.push_back(ptr);
+}
+
+void timer_object::wait_list::remove(const void* ptr) noexcept {
+  std::lock_guard<std::mutex> l(m_);
+  auto iter = std::find(v_.begin(),
+                        v_.end(),
+                        ptr);
+  if (iter != v_.end()) {
+    v_.erase(iter);
+  }
+}
+
+const std::vector<const void*>& timer_object::wait_list::get() const noexcept {
+  return v_;
+}
+
+void timer_object::wait_list::clear() noexcept {
+  v_.clear();
+}
+
+void timer_object::wait_list::pop_front() noexcept {
+  assert(!v_.empty());
+  v_.erase(v_.begin());
+}
+
+timer_object::timer_object(execution_context& ctx)
+  : base  (ctx),
+    waits_(std::make_shared<wait_list>())
+{}
+
+timer_object::timer_object(timer_object&& other)
+  : base  (std::move(other)),
+    waits_(std::exchange(other.waits_,
+                         std::make_shared<wait_list>()))
+{}
+
+timer_object& timer_object::operator=(timer_object&& rhs) {
+  assert(this != &rhs);
+  cancel();
+  auto waits = std::make_shared<wait_list>();
+  base::operator=(std::move(rhs));
+  waits_ = std::exchange(rhs.waits_,
+                         std::move(waits));
+  return *this;
+}
+
+timer_object::~timer_object() noexcept {
+  try {
+    cancel();
+  } catch (...) {}
+}
+
+std::size_t timer_object::cancel() {
+  auto l = waits_->lock();
+  auto&& user_data = waits_->get();
+  asio_uring::execution_context::submission_batch batch(get_service().context());
+  for (auto ptr : user_data) {
+    get_service().initiate_timeout_remove(ptr);
+  }
+  auto retr = user_data.size();
+  waits_->clear();
+  return retr;
+}
+
+std::size_t timer_object::cancel_one() {
+  auto l = waits_->lock();
+  auto&& user_data = waits_->get();
+  if (user_data.empty()) {
+    return 0;
+  }
+  get_service().initiate_timeout_remove(user_data.front());
+  waits_->pop_front();
+  return 1;
+}
+
+std::size_t timer_object::update(std::chrono::nanoseconds t,
+                                 unsigned flags)
+{
+  auto l = waits_->lock();
+  auto&& user_data = waits_->get();
+  asio_uring::execution_context::submission_batch batch(get_service().context());
+  for (auto ptr : user_data) {
+    get_service().initiate_timeout_update(ptr,
+                                          t,
+                                          flags);
+  }
+  return user_data.size();
+}
+
+}
@@ -0,0 +1,225 @@
+#include <asio_uring/buffer_ring.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <asio_uring/execution_context.hpp>
+#include <asio_uring/liburing.hpp>
+#include <errno.h>
+#include <sys/mman.h>
+
+namespace asio_uring {
+
+namespace {
+
+//  io_uring_buf_ring_add indexes through the bufs
+//  flexible array member which, when the kernel
+//  header is compiled as C++, follows an empty struct
+//  of size one and is therefore misplaced by a whole
+//  entry
+void add(::io_uring_buf_ring* ring,
+         void* addr,
+         unsigned len,
+         unsigned short id,
+         int mask,
+         int offset) noexcept
+{
+  auto bufs = reinterpret_cast<::io_uring_buf*>(ring);
+  auto&& buf = bufs[(ring->tail + offset) & mask];
+  buf.addr = reinterpret_cast<std::uintptr_t>(addr);
+  buf.len = len;
+  buf.bid = id;
+}
+
+}
+
+buffer_ring::lease::lease() noexcept
+  : ring_(nullptr),
+    id_  (0),
+    size_(0)
+{}
+
+buffer_ring::lease::lease(buffer_ring& ring,
+                          unsigned short id,
+                          std::size_t size) noexcept
+  : ring_(&ring),
+    id_  (id),
+    size_(size)
+{}
+
+buffer_ring::lease::lease(lease&& other) noexcept
+  : ring_(other.ring_),
+    id_  (other.id_),
+    size_(other.size_)
+{
+  other.ring_ = nullptr;
+  other.size_ = 0;
+}
+
+buffer_ring::lease& buffer_ring::lease::operator=(lease&& rhs) noexcept {
+  assert(this != &rhs);
+  release();
+  ring_ = rhs.ring_;
+  id_ = rhs.id_;
+  size_ = rhs.size_;
+  rhs.ring_ = nullptr;
+  rhs.size_ = 0;
+  return *this;
+}
+
+buffer_ring::lease::~lease() noexcept {
+  release();
+}
+
+void* buffer_ring::lease::data() const noexcept {
+  if (!ring_) {
+    return nullptr;
+  }
+  return ring_->buffer(id_);
+}
+
+std::size_t buffer_ring::lease::size() const noexcept {
+  return size_;
+}
+
+buffer_ring::lease::operator bool() const noexcept {
+  return ring_;
+}
+
+void buffer_ring::lease::release() noexcept {
+  if (ring_) {
+    ring_->recycle(id_);
+    ring_ = nullptr;
+    size_ = 0;
+  }
+}
+
+buffer_ring::unmap::unmap(std::size_t size) noexcept
+  : size_(size)
+{}
+
+void buffer_ring::unmap::operator()(::io_uring_buf_ring* ptr) const noexcept {
+  ::munmap(ptr,
+           size_);
+}
+
+buffer_ring::buffer_ring(execution_context& ctx,
+                         unsigned short group,
+                         unsigned entries,
+                         std::size_t buffer_size)
+  : ctx_        (&ctx),
+    group_      (group),
+    entries_    (entries),
+    buffer_size_(buffer_size),
+    ring_       (nullptr,
+                 unmap(0))
+{
+  if (!entries || (entries & (entries - 1)) || (entries > 32768) || !buffer_size) {
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+  }
+  buffers_ = std::make_unique<unsigned char[]>(entries * buffer_size);
+  //  The kernel requires the ring itself to be page
+  //  aligned
+  std::size_t size = entries * sizeof(::io_uring_buf);
+  void* ptr = ::mmap(nullptr,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_ANONYMOUS | MAP_PRIVATE,
+                     -1,
+                     0);
+  if (ptr == MAP_FAILED) {
+    std::error_code ec(errno,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  ring_ = ring_type(static_cast<::io_uring_buf_ring*>(ptr),
+                    unmap(size));
+  ::io_uring_buf_ring_init(ring_.get());
+  ::io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<std::uintptr_t>(ptr);
+  reg.ring_entries = entries;
+  reg.bgid = group;
+  std::lock_guard<std::mutex> l(ctx.buffer_rings_mutex_);
+  ctx.buffer_rings_.reserve(ctx.buffer_rings_.size() + 1);
+  int result = ::io_uring_register_buf_ring(ctx.native_handle(),
+                                            &reg,
+                                            0);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  ctx.buffer_rings_.push_back(this);
+  auto mask = ::io_uring_buf_ring_mask(entries);
+  for (unsigned i = 0; i < entries; ++i) {
+    unsigned short id(i);
+    add(ring_.get(),
+        buffer(id),
+        unsigned(buffer_size),
+        id,
+        mask,
+        int(i));
+  }
+  ::io_uring_buf_ring_advance(ring_.get(),
+                              entries);
+}
+
+buffer_ring::~buffer_ring() noexcept {
+  if (!ctx_) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(ctx_->buffer_rings_mutex_);
+  auto&& rings = ctx_->buffer_rings_;
+  rings.erase(std::find(rings.begin(),
+                        rings.end(),
+                        this));
+  ::io_uring_unregister_buf_ring(ctx_->native_handle(),
+                                 group_);
+}
+
+unsigned short buffer_ring::group() const noexcept {
+  return group_;
+}
+
+unsigned buffer_ring::entries() const noexcept {
+  return entries_;
+}
+
+std::size_t buffer_ring::buffer_size() const noexcept {
+  return buffer_size_;
+}
+
+buffer_ring::lease buffer_ring::get(const ::io_uring_cqe& cqe) noexcept {
+  if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+    return lease();
+  }
+  unsigned short id(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+  assert(id < entries_);
+  return lease(*this,
+               id,
+               (cqe.res > 0) ? std::size_t(cqe.res) : 0);
+}
+
+void buffer_ring::recycle(unsigned short id) noexcept {
+  //  Leases may be released on any thread but the
+  //  ring has a single producer
+  std::lock_guard<spin_lock> l(lock_);
+  add(ring_.get(),
+      buffer(id),
+      unsigned(buffer_size_),
+      id,
+      ::io_uring_buf_ring_mask(entries_),
+      0);
+  ::io_uring_buf_ring_advance(ring_.get(),
+                              1);
+}
+
+void* buffer_ring::buffer(unsigned short id) const noexcept {
+  return buffers_.get() + (std::size_t(id) * buffer_size_);
+}
+
+}
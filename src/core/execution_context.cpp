@@ -1,17 +1,22 @@
 #include <asio_uring/execution_context.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <system_error>
-#include <thread>
+#include <asio_uring/buffer_ring.hpp>
 #include <asio_uring/liburing.hpp>
 #include <errno.h>
 #include <poll.h>
+#include <sys/resource.h>
 
 #include <iostream>
 
@@ -41,6 +46,26 @@ T& from_user_data(std::uint64_t user_data) noexcept {
   return *ptr;
 }
 
+//  Distinguishes the completions of wake up messages
+//  (whose user_data is the address of the target's
+//  wake_target) from those of operations
+constexpr std::uint64_t msg_ring_tag = 1;
+//  Distinguishes the completions of timeouts linked to
+//  operations (whose user_data is the address of the
+//  operation's completion) from those of the operations
+constexpr std::uint64_t link_timeout_tag = 2;
+//  Distinguishes the completions of operations
+//  submitted by submit_detached (whose user_data is
+//  the address of their detached_operation)
+constexpr std::uint64_t detached_tag = 4;
+
+//  The states of a completion's operation and the
+//  timeout linked to it (see join_link)
+constexpr unsigned char link_state_linked = 1;
+constexpr unsigned char link_state_operation = 2;
+constexpr unsigned char link_state_timeout = 4;
+constexpr unsigned char link_state_expired = 8;
+
 enum class error {
   success = 0,
   no_sqe_for_eventfd,
@@ -85,13 +110,39 @@ std::error_code make_error_code(error err) noexcept {
                          category);
 }
 
+bool busy(const std::error_code& ec) noexcept {
+  return (ec == std::errc::device_or_resource_busy) ||
+         (ec == std::errc::resource_unavailable_try_again);
+}
+
 [[noreturn]]
 void throw_error_code(error err) {
   throw std::system_error(make_error_code(err));
 }
 
+class unlock_guard {
+public:
+  explicit unlock_guard(std::unique_lock<std::mutex>& l) noexcept
+    : l_(l)
+  {
+    assert(l_.owns_lock());
+    l_.unlock();
+  }
+  unlock_guard(const unlock_guard&) = delete;
+  unlock_guard(unlock_guard&&) = delete;
+  unlock_guard& operator=(const unlock_guard&) = delete;
+  unlock_guard& operator=(unlock_guard&&) = delete;
+  ~unlock_guard() noexcept {
+    l_.lock();
+  }
+private:
+  std::unique_lock<std::mutex>& l_;
+};
+
 }
 
+thread_local const execution_context::run_guard* execution_context::top_ = nullptr;
+
 execution_context::executor_type::executor_type(execution_context& ctx) noexcept
   : ctx_(&ctx)
 {}
@@ -129,29 +180,128 @@ bool execution_context::executor_type::operator!=(const executor_type& rhs) cons
 }
 
 execution_context::execution_context(unsigned entries,
-                                     unsigned flags)
+                                     unsigned flags,
+                                     std::size_t concurrency_hint)
+  : q_started_   (false),
+    stop_started_(false),
+    zero_started_(false),
+    work_        (0),
+    stopped_     (false),
+    unsubmitted_ (false),
+    batches_     (0),
+    u_           (entries,
+                  flags),
+    runners_     (0),
+    concurrent_  (concurrency_hint != 1),
+    leader_      (false),
+    idle_        (0),
+    msg_ring_    (false),
+    wake_        (new wake_target(*this),
+                  &wake_target::detach),
+    throttle_    (false),
+    cq_overflows_(0),
+    parked_      (0)
+{
+  initialize();
+}
+
+execution_context::execution_context(unsigned entries,
+                                     ::io_uring_params& params,
+                                     std::size_t concurrency_hint)
   : q_started_   (false),
-    pending_     (0),
     stop_started_(false),
     zero_started_(false),
     work_        (0),
     stopped_     (false),
+    unsubmitted_ (false),
+    batches_     (0),
     u_           (entries,
-                  flags)
+                  params),
+    runners_     (0),
+    concurrent_  (concurrency_hint != 1),
+    leader_      (false),
+    idle_        (0),
+    msg_ring_    (false),
+    wake_        (new wake_target(*this),
+                  &wake_target::detach),
+    throttle_    (false),
+    cq_overflows_(0),
+    parked_      (0)
 {
-  int arr[3];
+  if (concurrent_ && (params.flags & IORING_SETUP_SINGLE_ISSUER)) {
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+  }
+  initialize();
+}
+
+execution_context::~execution_context() noexcept {
+  //  Messages this execution context sent whose
+  //  completions were never reaped must still wake
+  //  their targets and release them
+  unsigned head;
+  ::io_uring_cqe* cqe;
+  unsigned seen = 0;
+  io_uring_for_each_cqe(u_.native_handle(), head, cqe) {
+    ++seen;
+    if (cqe->user_data & msg_ring_tag) {
+      try {
+        handle_msg_ring(*cqe);
+      } catch (...) {}
+    }
+  }
+  ::io_uring_cq_advance(u_.native_handle(),
+                        seen);
+  //  The kernel does not access the storage of an
+  //  operation once it has been submitted
+  while (!detached_.empty()) {
+    delete &detached_.front();
+  }
+  //  Closing the ring unregisters the buffer rings
+  //  so they must not attempt to do so themselves
+  std::lock_guard<std::mutex> l(buffer_rings_mutex_);
+  for (auto ring : buffer_rings_) {
+    ring->ctx_ = nullptr;
+  }
+}
+
+void execution_context::initialize() {
+  //  The first three slots hold the internal eventfds,
+  //  the rest are free for register_file
+  std::size_t size = 3 + config::registered_files;
+  ::rlimit limit;
+  if (!::getrlimit(RLIMIT_NOFILE,
+                   &limit) && (limit.rlim_cur < size))
+  {
+    size = std::max<std::size_t>(limit.rlim_cur,
+                                 3);
+  }
+  std::vector<int> arr(size,
+                       -1);
   arr[0] = q_.native_handle();
   arr[1] = stop_.native_handle();
   arr[2] = zero_.native_handle();
   if (::io_uring_register(u_.native_handle()->ring_fd,
                           IORING_REGISTER_FILES,
-                          arr,
-                          3))
+                          arr.data(),
+                          unsigned(arr.size())))
   {
     std::error_code ec(errno,
                        std::generic_category());
     throw std::system_error(ec);
   }
+  if (auto probe = ::io_uring_get_probe_ring(u_.native_handle())) {
+    for (std::size_t i = 0; i < opcodes_.size(); ++i) {
+      opcodes_[i] = ::io_uring_opcode_supported(probe,
+                                                int(i));
+    }
+    ::io_uring_free_probe(probe);
+  }
+  msg_ring_ = opcodes_[IORING_OP_MSG_RING];
+  //  Lowest indices at the back so they're reused first
+  files_.reserve(size - 3);
+  for (std::size_t i = size; i > 3; --i) {
+    files_.push_back(int(i - 1));
+  }
   restart();
 }
 
@@ -160,6 +310,7 @@ execution_context::executor_type execution_context::get_executor() noexcept {
 }
 
 void execution_context::restart() {
+  auto l = lock();
   restart_if(0,
              q_started_);
   restart_if(1,
@@ -201,41 +352,592 @@ execution_context::const_native_handle_type execution_context::native_handle() c
 }
 
 bool execution_context::running_in_this_thread() const noexcept {
-  return tid_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+  for (auto frame = top_; frame; frame = frame->next()) {
+    if (&frame->context() == this) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool execution_context::concurrent() const noexcept {
+  return concurrent_;
+}
+
+std::size_t execution_context::outstanding_work() const noexcept {
+  return work_.load(std::memory_order_relaxed);
+}
+
+void execution_context::register_buffers(const ::iovec* iovs,
+                                         unsigned n)
+{
+  int result = ::io_uring_register_buffers(u_.native_handle(),
+                                           iovs,
+                                           n);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+void execution_context::register_buffers(unsigned n) {
+  int result = ::io_uring_register_buffers_sparse(u_.native_handle(),
+                                                  n);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+void execution_context::update_buffers(unsigned offset,
+                                       const ::iovec* iovs,
+                                       unsigned n)
+{
+  int result = ::io_uring_register_buffers_update_tag(u_.native_handle(),
+                                                      offset,
+                                                      iovs,
+                                                      nullptr,
+                                                      n);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+void execution_context::unregister_buffers() {
+  int result = ::io_uring_unregister_buffers(u_.native_handle());
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+int execution_context::register_file(int fd) {
+  std::lock_guard<std::mutex> l(files_mutex_);
+  if (files_.empty()) {
+    throw std::system_error(std::make_error_code(std::errc::too_many_files_open));
+  }
+  int index = files_.back();
+  int result = ::io_uring_register_files_update(u_.native_handle(),
+                                                unsigned(index),
+                                                &fd,
+                                                1);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  files_.pop_back();
+  return index;
+}
+
+void execution_context::unregister_file(int index) {
+  assert(index >= 3);
+  std::lock_guard<std::mutex> l(files_mutex_);
+  int fd = -1;
+  int result = ::io_uring_register_files_update(u_.native_handle(),
+                                                unsigned(index),
+                                                &fd,
+                                                1);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  files_.push_back(index);
 }
 
 bool execution_context::out_of_work() const noexcept {
   return !work_.load(std::memory_order_acquire);
 }
 
+bool execution_context::recover() {
+  //  Completions which did not fit in the completion
+  //  queue are held by the kernel and are only moved
+  //  into the completion queue when the kernel is
+  //  entered with IORING_ENTER_GETEVENTS
+  auto handle = u_.native_handle();
+  if (!::io_uring_cq_has_overflow(handle)) {
+    return false;
+  }
+  cq_overflows_.fetch_add(1,
+                          std::memory_order_relaxed);
+  int result = ::io_uring_get_events(handle);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    if (!busy(ec)) {
+      throw std::system_error(ec);
+    }
+  }
+  return true;
+}
+
+bool execution_context::cq_ready() {
+  auto handle = u_.native_handle();
+  if (::io_uring_cq_ready(handle)) {
+    return true;
+  }
+  if (recover()) {
+    return ::io_uring_cq_ready(handle);
+  }
+  //  With IORING_SETUP_DEFER_TASKRUN (or when the kernel
+  //  has flagged pending task work) completions are only
+  //  posted when the kernel is entered
+  if (!(handle->flags & IORING_SETUP_DEFER_TASKRUN) &&
+      !(IO_URING_READ_ONCE(*handle->sq.kflags) & IORING_SQ_TASKRUN))
+  {
+    return false;
+  }
+  int result = ::io_uring_get_events(handle);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  return ::io_uring_cq_ready(handle);
+}
+
+bool execution_context::throttled() const noexcept {
+  return throttle_.load(std::memory_order_relaxed) &&
+         ::io_uring_cq_has_overflow(u_.native_handle());
+}
+
+execution_context::statistics execution_context::stats() const noexcept {
+  statistics retr;
+  retr.cq_overflows = cq_overflows_.load(std::memory_order_relaxed);
+  retr.cq_dropped = IO_URING_READ_ONCE(*u_.native_handle()->cq.koverflow);
+  retr.parked = parked_.load(std::memory_order_relaxed);
+  return retr;
+}
+
+void execution_context::set_throttle_on_overflow(bool enable) noexcept {
+  throttle_.store(enable,
+                  std::memory_order_relaxed);
+}
+
+bool execution_context::opcode_supported(int opcode) const noexcept {
+  if ((opcode < 0) || (std::size_t(opcode) >= opcodes_.size())) {
+    return false;
+  }
+  return opcodes_[opcode];
+}
+
 ::io_uring_sqe& execution_context::get_sqe() {
-  auto sqe = ::io_uring_get_sqe(u_.native_handle());
+  auto sqe = try_get_sqe();
   if (!sqe) {
-    throw_error_code(error::no_sqe_for_eventfd);
+    throw_error_code(error::no_sqe);
   }
   return *sqe;
 }
 
-execution_context::tid_guard::tid_guard(std::atomic<std::thread::id>& tid) noexcept
-  : tid_(tid)
+::io_uring_sqe* execution_context::try_get_sqe(unsigned n) {
+  //  When n is greater than one the caller obtains the
+  //  remaining entries via ::io_uring_get_sqe which
+  //  yields consecutive entries so there must be room
+  //  for all of them up front
+  auto handle = u_.native_handle();
+  if ((::io_uring_sq_space_left(handle) < n) && unsubmitted_) {
+    flush();
+  }
+  //  When the kernel polls the submission queue flushed
+  //  entries only free up space once that thread has
+  //  consumed them
+  if ((::io_uring_sq_space_left(handle) < n) && (handle->flags & IORING_SETUP_SQPOLL)) {
+    int result = ::io_uring_sqring_wait(handle);
+    if (result < 0) {
+      std::error_code ec(-result,
+                         std::generic_category());
+      throw std::system_error(ec);
+    }
+  }
+  if (::io_uring_sq_space_left(handle) < n) {
+    return nullptr;
+  }
+  return ::io_uring_get_sqe(handle);
+}
+
+void execution_context::link_timeout(::io_uring_sqe& sqe,
+                                     const ::__kernel_timespec& timeout) noexcept
+{
+  sqe.flags |= IOSQE_IO_LINK;
+  auto link = ::io_uring_get_sqe(u_.native_handle());
+  assert(link);
+  ::io_uring_prep_link_timeout(link,
+                               const_cast<::__kernel_timespec*>(&timeout),
+                               0);
+  //  The timeout completes whether it fires or not and
+  //  its completion is joined with that of the operation
+  //  (see join_link)
+  auto&& c = from_user_data<completion>(sqe.user_data);
+  c.link_ = link_state_linked;
+  static_assert(alignof(completion) > link_timeout_tag);
+  link->user_data = sqe.user_data | link_timeout_tag;
+}
+
+bool execution_context::join_link(::io_uring_cqe& cqe) noexcept {
+  //  Completions are harvested by one thread at a time
+  //  (see handle_cqes and reap) so no synchronization
+  //  is required
+  auto&& c = from_user_data<completion>(cqe.user_data & ~link_timeout_tag);
+  if (cqe.user_data & link_timeout_tag) {
+    assert(c.link_ & link_state_linked);
+    assert(!(c.link_ & link_state_timeout));
+    c.link_ |= link_state_timeout;
+    if (cqe.res == -ETIME) {
+      c.link_ |= link_state_expired;
+    }
+    if (!(c.link_ & link_state_operation)) {
+      return false;
+    }
+  } else {
+    if (!(c.link_ & link_state_linked)) {
+      return true;
+    }
+    assert(!(c.link_ & link_state_operation));
+    c.link_ |= link_state_operation;
+    c.res_ = cqe.res;
+    c.flags_ = cqe.flags;
+    if (!(c.link_ & link_state_timeout)) {
+      return false;
+    }
+  }
+  cqe = ::io_uring_cqe{};
+  cqe.user_data = to_user_data(c);
+  cqe.res = c.res_;
+  cqe.flags = c.flags_;
+  //  The kernel completes an operation cancelled by
+  //  its linked timeout with -ECANCELED and the timeout
+  //  itself with -ETIME
+  if ((c.link_ & link_state_expired) && (cqe.res == -ECANCELED)) {
+    cqe.res = -ETIME;
+  }
+  c.link_ = 0;
+  return true;
+}
+
+void execution_context::submit() {
+  auto l = lock();
+  submit_impl();
+}
+
+std::unique_lock<std::mutex> execution_context::lock() const {
+  if (!concurrent_) {
+    return std::unique_lock<std::mutex>(mutex_,
+                                        std::defer_lock);
+  }
+  return std::unique_lock<std::mutex>(mutex_);
+}
+
+void execution_context::submit_impl() {
+  unsubmitted_ = true;
+  //  When concurrent the leader may already be blocked
+  //  in the kernel and would therefore never flush
+  if (batches_ || (!concurrent_ && running_in_this_thread())) {
+    return;
+  }
+  flush();
+}
+
+execution_context::submission_batch::submission_batch(execution_context& ctx)
+  : self_(ctx)
+{
+  auto l = self_.lock();
+  ++self_.batches_;
+}
+
+execution_context::submission_batch::~submission_batch() noexcept {
+  auto l = self_.lock();
+  assert(self_.batches_);
+  if (--self_.batches_ || (!self_.concurrent_ && self_.running_in_this_thread())) {
+    return;
+  }
+  std::error_code ec;
+  self_.flush(ec);
+}
+
+execution_context::flush_guard::flush_guard(execution_context& self) noexcept
+  : self_      (self),
+    exceptions_(std::uncaught_exceptions())
+{}
+
+execution_context::flush_guard::~flush_guard() noexcept(false) {
+  std::error_code ec;
+  self_.flush(ec);
+  //  As for flush except that an error must not replace
+  //  an exception which is already propagating (the
+  //  entries remain unsubmitted and are submitted by the
+  //  next call)
+  if (!ec || busy(ec) || (std::uncaught_exceptions() > exceptions_)) {
+    return;
+  }
+  throw std::system_error(ec);
+}
+
+void execution_context::flush() {
+  std::error_code ec;
+  flush(ec);
+  //  The kernel may refuse submissions while completions
+  //  are backed up in which case the entries remain in
+  //  the submission queue and are submitted once
+  //  completions have been reaped
+  if (ec && !busy(ec)) {
+    throw std::system_error(ec);
+  }
+}
+
+void execution_context::flush(std::error_code& ec) noexcept {
+  ec.clear();
+  if (!unsubmitted_) {
+    return;
+  }
+  int result = ::io_uring_submit(u_.native_handle());
+  if (result < 0) {
+    ec.assign(-result,
+              std::generic_category());
+    return;
+  }
+  unsubmitted_ = false;
+}
+
+void execution_context::detached_operation::complete(const ::io_uring_cqe&) {
+  //  Consumed by handle_cqe rather than dispatched
+  assert(false);
+}
+
+execution_context::detached_operation& execution_context::acquire_detached() {
+  auto op = std::make_unique<detached_operation>();
+  detached_.push_back(*op);
+  return *op.release();
+}
+
+void execution_context::set_detached(::io_uring_sqe& sqe,
+                                     detached_operation& op) noexcept
+{
+  completion& c = op;
+  static_assert(alignof(completion) > detached_tag);
+  sqe.user_data = to_user_data(c) | detached_tag;
+}
+
+void execution_context::park(const ::io_uring_sqe& sqe,
+                             const ::__kernel_timespec* timeout) noexcept
+{
+  auto&& c = from_user_data<completion>(sqe.user_data & ~detached_tag);
+  assert(!c.hook_.is_linked());
+  c.sqe_ = sqe;
+  c.timeout_ = timeout;
+  c.owner_ = this;
+  pending_.push_back(c);
+  parked_.fetch_add(1,
+                    std::memory_order_relaxed);
+}
+
+void execution_context::submit_pending() {
+  while (!(pending_.empty() || throttled())) {
+    auto&& c = pending_.front();
+    auto sqe = try_get_sqe(c.timeout_ ? 2 : 1);
+    if (!sqe) {
+      return;
+    }
+    pending_.pop_front();
+    c.owner_ = nullptr;
+    *sqe = c.sqe_;
+    if (c.timeout_) {
+      link_timeout(*sqe,
+                   *c.timeout_);
+      c.timeout_ = nullptr;
+    }
+    unsubmitted_ = true;
+  }
+}
+
+bool execution_context::unpark(completion& c) noexcept {
+  auto l = lock();
+  if (!c.hook_.is_linked()) {
+    return false;
+  }
+  assert(c.owner_ == this);
+  c.hook_.unlink();
+  c.owner_ = nullptr;
+  c.timeout_ = nullptr;
+  return true;
+}
+
+void execution_context::notify_idle() {
+  assert(concurrent_);
+  if (!idle_.load(std::memory_order_seq_cst)) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(mutex_);
+  cv_.notify_one();
+}
+
+void execution_context::notify() {
+  //  If the producer is itself running an execution
+  //  context the wake up may be delivered by a message
+  //  from that ring to this one which is batched with
+  //  the producer's other submissions and which does not
+  //  require the consumer to read the eventfd and re-arm
+  //  its poll
+  execution_context* source = top_ ? &top_->context() : nullptr;
+  if (source && (source != this) && msg_ring_) {
+    try {
+      //  The wake up must not be parked behind other
+      //  operations
+      auto l = source->lock();
+      auto sqe = source->pending_.empty() ? source->try_get_sqe() : nullptr;
+      if (sqe) {
+        ::io_uring_prep_msg_ring(sqe,
+                                 u_.native_handle()->ring_fd,
+                                 0,
+                                 to_user_data(q_),
+                                 0);
+        //  Whether the message was delivered is only known
+        //  once it completes on the source ring so the
+        //  source keeps running (and this object's
+        //  wake_target remains valid) until it has handled
+        //  that completion (see handle_msg_ring)
+        static_assert(alignof(wake_target) > msg_ring_tag);
+        sqe->user_data = to_user_data(*wake_) | msg_ring_tag;
+        wake_->acquire();
+        source->get_executor().on_work_started();
+        source->submit_impl();
+        return;
+      }
+    } catch (...) {}
+  }
+  q_.notify();
+}
+
+execution_context::completion::completion() noexcept
+  : dispatch_(&virtual_dispatch),
+    timeout_ (nullptr),
+    owner_   (nullptr),
+    link_    (0),
+    res_     (0),
+    flags_   (0)
+{}
+
+execution_context::completion::completion(const completion& other) noexcept
+  : dispatch_(other.dispatch_),
+    timeout_ (nullptr),
+    owner_   (nullptr),
+    link_    (0),
+    res_     (0),
+    flags_   (0)
+{}
+
+execution_context::completion& execution_context::completion::operator=(const completion& rhs) noexcept {
+  dispatch_ = rhs.dispatch_;
+  return *this;
+}
+
+execution_context::completion::~completion() noexcept {
+  //  The hook would unlink itself but not while holding
+  //  the lock which guards the list of parked operations
+  if (owner_) {
+    owner_->unpark(*this);
+  }
+}
+
+void execution_context::completion::virtual_dispatch(completion& self,
+                                                     const ::io_uring_cqe& cqe)
 {
-#ifdef NDEBUG
-  tid_.store(std::this_thread::get_id(),
-             std::memory_order_relaxed);
-#else
-  assert(tid_.exchange(std::this_thread::get_id(),
-                       std::memory_order_relaxed) == std::thread::id());
-#endif
+  self.complete(cqe);
+}
+
+execution_context::wake_target::wake_target(execution_context& self) noexcept
+  : refs_(1),
+    self_(&self)
+{}
+
+void execution_context::wake_target::acquire() noexcept {
+  refs_.fetch_add(1,
+                  std::memory_order_relaxed);
 }
 
-execution_context::tid_guard::~tid_guard() noexcept {
-#ifdef NDEBUG
-  tid_.store(std::thread::id(),
-             std::memory_order_relaxed);
-#else
-  assert(tid_.exchange(std::thread::id(),
-                       std::memory_order_relaxed) == std::this_thread::get_id());
-#endif
+void execution_context::wake_target::release(wake_target* self) noexcept {
+  assert(self);
+  if (self->refs_.fetch_sub(1,
+                            std::memory_order_acq_rel) == 1)
+  {
+    delete self;
+  }
+}
+
+void execution_context::wake_target::detach(wake_target* self) noexcept {
+  assert(self);
+  {
+    std::lock_guard<std::mutex> l(self->mutex_);
+    self->self_ = nullptr;
+  }
+  release(self);
+}
+
+void execution_context::wake_target::notify() {
+  std::lock_guard<std::mutex> l(mutex_);
+  if (self_) {
+    self_->q_.notify();
+  }
+}
+
+void execution_context::handle_msg_ring(const ::io_uring_cqe& cqe) {
+  assert(cqe.user_data & msg_ring_tag);
+  std::unique_ptr<wake_target,
+                  decltype(&wake_target::release)> target(&from_user_data<wake_target>(cqe.user_data & ~msg_ring_tag),
+                                                          &wake_target::release);
+  class guard {
+  public:
+    explicit guard(execution_context& self) noexcept
+      : self_(self)
+    {}
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+    ~guard() noexcept {
+      self_.get_executor().on_work_finished();
+    }
+  private:
+    execution_context& self_;
+  };
+  guard g(*this);
+  //  The message was not delivered (e.g. because the
+  //  target's completion queue was full) and the target
+  //  may be asleep
+  if (cqe.res < 0) {
+    target->notify();
+  }
+}
+
+execution_context::run_guard::run_guard(execution_context& self) noexcept
+  : self_(self),
+    next_(top_)
+{
+  auto prev = self_.runners_.fetch_add(1,
+                                       std::memory_order_relaxed);
+  assert(self_.concurrent_ || !prev);
+  (void)prev;
+  top_ = this;
+}
+
+execution_context::run_guard::~run_guard() noexcept {
+  assert(top_ == this);
+  top_ = next_;
+  self_.runners_.fetch_sub(1,
+                           std::memory_order_relaxed);
+}
+
+execution_context& execution_context::run_guard::context() const noexcept {
+  return self_;
+}
+
+const execution_context::run_guard* execution_context::run_guard::next() const noexcept {
+  return next_;
 }
 
 execution_context::handle_cqe_type::handle_cqe_type() noexcept
@@ -245,26 +947,28 @@ execution_context::handle_cqe_type::handle_cqe_type() noexcept
 
 template<bool Blocking>
 execution_context::count_type execution_context::all_impl() {
+  if (concurrent_) {
+    return concurrent_impl<Blocking>(std::numeric_limits<count_type>::max());
+  }
   if (stopped() || out_of_work()) {
     stopped_.store(true,
                    std::memory_order_relaxed);
     return 0;
   }
   count_type retr = 0;
-  tid_guard tid_g(tid_);
+  run_guard run_g(*this);
+  flush_guard flush_g(*this);
   for (;;) {
     assert(!stopped());
-    auto tmp = pending_;
-    auto done = service_queue(pending_);
-    assert(!pending_);
-    retr += tmp;
-    if (done) {
+    auto queued = service_queues(std::numeric_limits<count_type>::max());
+    retr += queued.handlers;
+    if (queued.stopped) {
       stopped_.store(true,
                      std::memory_order_relaxed);
       return retr;
     }
     assert(!stopped());
-    auto result = impl<Blocking>();
+    auto result = impl<Blocking>(std::numeric_limits<count_type>::max());
     retr += result.handlers;
     if (result.stopped) {
       stopped_.store(true,
@@ -278,50 +982,307 @@ execution_context::count_type execution_context::all_impl() {
 
 template<bool Blocking>
 execution_context::count_type execution_context::one_impl() {
+  if (concurrent_) {
+    return concurrent_impl<Blocking>(1);
+  }
   if (stopped() || out_of_work()) {
     stopped_.store(true,
                    std::memory_order_relaxed);
     return 0;
   }
-  tid_guard tid_g(tid_);
-  if (pending_) {
-    service_queue(1);
-    stopped_.store(true,
-                   std::memory_order_relaxed);
-    return 1;
+  run_guard run_g(*this);
+  flush_guard flush_g(*this);
+  for (;;) {
+    auto result = service_queues(1);
+    if (!result.handlers) {
+      result = impl<Blocking>(1);
+    }
+    if (result.handlers || result.stopped) {
+      stopped_.store(true,
+                     std::memory_order_relaxed);
+      return result.handlers;
+    }
+    restart_if(0,
+               q_started_);
   }
-  auto handlers = impl<Blocking>().handlers;
-  stopped_.store(true,
-                 std::memory_order_relaxed);
-  return handlers;
 }
 
 template<bool Blocking>
-execution_context::handle_cqe_type execution_context::impl() {
+execution_context::handle_cqe_type execution_context::impl(count_type max) {
   assert(!stopped());
-  ::io_uring_cqe* cqe;
-  int result;
+  assert(max);
+  bool recovered = recover();
+  submit_pending();
   if constexpr (Blocking) {
-    result = ::io_uring_wait_cqe(u_.native_handle(),
-                                 &cqe);
+    if (local_.empty() && !recovered && q_.sleep()) {
+      wait();
+    } else {
+      flush();
+    }
   } else {
-    result = ::io_uring_peek_cqe(u_.native_handle(),
-                                 &cqe);
-  }
-  if (result < 0) {
-    std::error_code ec(errno,
-                       std::generic_category());
-    throw std::system_error(ec);
-  }
-  if constexpr (!Blocking) {
-    if (!cqe) {
+    flush();
+    if (!cq_ready()      &&
+        local_.empty()   &&
+        q_.empty())
+    {
       handle_cqe_type retr;
       retr.stopped = true;
       return retr;
     }
   }
+  return handle_cqes(max);
+}
+
+template<bool Blocking>
+execution_context::count_type execution_context::concurrent_impl(count_type max) {
+  assert(max);
+  class guard {
+  public:
+    explicit guard(std::condition_variable& cv) noexcept
+      : cv_(cv)
+    {}
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+    ~guard() noexcept {
+      //  Threads waiting for the leader may need to
+      //  observe that this thread stopped
+      cv_.notify_all();
+    }
+  private:
+    std::condition_variable& cv_;
+  };
+  run_guard run_g(*this);
+  guard g(cv_);
+  auto l = lock();
+  count_type retr = 0;
+  for (;;) {
+    if (stopped_.load(std::memory_order_acquire) || out_of_work()) {
+      stopped_.store(true,
+                     std::memory_order_relaxed);
+      return retr;
+    }
+    if (retr >= max) {
+      return retr;
+    }
+    if (!ready_.empty()) {
+      auto cqe = ready_.front();
+      ready_.pop_front();
+      ++retr;
+      unlock_guard u(l);
+      from_user_data<completion>(cqe.user_data).dispatch(cqe);
+      continue;
+    }
+    if (q_.consume_one([&](auto&& func) { ++retr;
+                                          unlock_guard u(l);
+                                          class guard {
+                                          public:
+                                            explicit guard(execution_context& self) noexcept
+                                              : self_(self)
+                                            {}
+                                            guard(const guard&) = delete;
+                                            guard(guard&&) = delete;
+                                            guard& operator=(const guard&) = delete;
+                                            guard& operator=(guard&&) = delete;
+                                            ~guard() noexcept {
+                                              self_.get_executor().on_work_finished();
+                                            }
+                                          private:
+                                            execution_context& self_;
+                                          };
+                                          guard g(*this);
+                                          func(); }))
+    {
+      continue;
+    }
+    if (!leader_) {
+      if (lead<Blocking>(l)) {
+        continue;
+      }
+      return retr;
+    }
+    if constexpr (!Blocking) {
+      return retr;
+    }
+    //  Pairs with the check of idle_ by producers (see
+    //  notify_idle) so that a function posted after the
+    //  queue is observed to be empty causes a notification
+    idle_.fetch_add(1,
+                    std::memory_order_seq_cst);
+    if (q_.empty()) {
+      cv_.wait(l);
+    }
+    idle_.fetch_sub(1,
+                    std::memory_order_relaxed);
+  }
+}
+
+template<bool Blocking>
+bool execution_context::lead(std::unique_lock<std::mutex>& l) {
+  assert(l.owns_lock());
+  assert(!leader_);
+  class guard {
+  public:
+    explicit guard(execution_context& self) noexcept
+      : self_(self)
+    {
+      self_.leader_ = true;
+    }
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+    ~guard() noexcept {
+      self_.leader_ = false;
+      self_.cv_.notify_all();
+    }
+  private:
+    execution_context& self_;
+  };
+  guard g(*this);
+  restart_if(0,
+             q_started_);
+  submit_pending();
+  flush();
+  auto handle = u_.native_handle();
+  if (!cq_ready()) {
+    if constexpr (!Blocking) {
+      return false;
+    }
+    if (!q_.sleep()) {
+      return true;
+    }
+    class wake_guard {
+    public:
+      explicit wake_guard(queue_type& q) noexcept
+        : q_(q)
+      {}
+      wake_guard(const wake_guard&) = delete;
+      wake_guard(wake_guard&&) = delete;
+      wake_guard& operator=(const wake_guard&) = delete;
+      wake_guard& operator=(wake_guard&&) = delete;
+      ~wake_guard() noexcept {
+        q_.wake();
+      }
+    private:
+      queue_type& q_;
+    };
+    wake_guard wake_g(q_);
+    unlock_guard u(l);
+    //  Only the leader touches the completion queue and
+    //  this does not touch the submission queue so other
+    //  threads may continue to submit
+    ::io_uring_cqe* cqe;
+    int result = ::io_uring_wait_cqe(handle,
+                                     &cqe);
+    if (result < 0) {
+      std::error_code ec(-result,
+                         std::generic_category());
+      throw std::system_error(ec);
+    }
+  }
+  reap();
+  return true;
+}
+
+void execution_context::reap() {
+  class guard {
+  public:
+    explicit guard(native_handle_type handle) noexcept
+      : handle_(handle),
+        seen_  (0)
+    {}
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+    ~guard() noexcept {
+      ::io_uring_cq_advance(handle_,
+                            seen_);
+    }
+    void seen() noexcept {
+      ++seen_;
+    }
+  private:
+    native_handle_type handle_;
+    unsigned           seen_;
+  };
+  guard g(native_handle());
+  unsigned head;
+  ::io_uring_cqe* cqe;
+  io_uring_for_each_cqe(native_handle(), head, cqe) {
+    if (stopped()) {
+      return;
+    }
+    if (!internal(*cqe)) {
+      auto copy = *cqe;
+      if (join_link(copy)) {
+        ready_.push_back(copy);
+      }
+      g.seen();
+      continue;
+    }
+    g.seen();
+    if (handle_cqe(*cqe).stopped) {
+      stopped_.store(true,
+                     std::memory_order_relaxed);
+      return;
+    }
+    restart_if(0,
+               q_started_);
+  }
+}
+
+bool execution_context::internal(const ::io_uring_cqe& cqe) const noexcept {
+  return (cqe.user_data == to_user_data(q_started_))    ||
+         (cqe.user_data == to_user_data(stop_started_)) ||
+         (cqe.user_data == to_user_data(zero_started_)) ||
+         (cqe.user_data == to_user_data(q_))            ||
+         (cqe.user_data & msg_ring_tag)                 ||
+         (cqe.user_data & detached_tag);
+}
+
+void execution_context::wait() {
+  class guard {
+  public:
+    explicit guard(queue_type& q) noexcept
+      : q_(q)
+    {}
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
+    ~guard() noexcept {
+      q_.wake();
+    }
+  private:
+    queue_type& q_;
+  };
+  guard g(q_);
+  int result;
+  if (unsubmitted_) {
+    result = ::io_uring_submit_and_wait(u_.native_handle(),
+                                        1);
+    if (result >= 0) {
+      unsubmitted_ = false;
+    } else {
+      std::error_code ec(-result,
+                         std::generic_category());
+      if (!busy(ec)) {
+        throw std::system_error(ec);
+      }
+    }
+  }
+  ::io_uring_cqe* cqe;
+  result = ::io_uring_wait_cqe(u_.native_handle(),
+                               &cqe);
+  if (result < 0) {
+    std::error_code ec(-result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
   assert(cqe);
-  return handle_cqe(*cqe);
 }
 
 bool execution_context::stopped() const noexcept {
@@ -338,7 +1299,7 @@ void execution_context::restart(std::size_t i,
                                 bool& b)
 {
   assert(!b);
-  ::io_uring_sqe* sqe = ::io_uring_get_sqe(u_.native_handle());
+  ::io_uring_sqe* sqe = try_get_sqe();
   if (!sqe) {
     throw_error_code(error::no_sqe_for_eventfd);
   }
@@ -347,11 +1308,7 @@ void execution_context::restart(std::size_t i,
                            POLLIN);
   sqe->flags |= IOSQE_FIXED_FILE;
   sqe->user_data = to_user_data(b);
-  if (::io_uring_submit(u_.native_handle()) < 0) {
-    std::error_code ec(errno,
-                       std::generic_category());
-    throw std::system_error(ec);
-  }
+  submit_impl();
   b = true;
 }
 
@@ -366,29 +1323,55 @@ void execution_context::restart_if(std::size_t i,
   assert(b);
 }
 
-execution_context::handle_cqe_type execution_context::handle_cqe(::io_uring_cqe& cqe) {
-  assert(!stopped());
+execution_context::handle_cqe_type execution_context::handle_cqes(count_type max) {
   class guard {
   public:
-    guard(native_handle_type handle,
-          ::io_uring_cqe& cqe) noexcept
+    explicit guard(native_handle_type handle) noexcept
       : handle_(handle),
-        cqe_   (cqe)
+        seen_  (0)
     {}
-    guard(const guard&);
-    guard(guard&&);
-    guard& operator=(const guard&);
-    guard& operator=(guard&&);
+    guard(const guard&) = delete;
+    guard(guard&&) = delete;
+    guard& operator=(const guard&) = delete;
+    guard& operator=(guard&&) = delete;
     ~guard() noexcept {
-      ::io_uring_cqe_seen(handle_,
-                          &cqe_);
+      ::io_uring_cq_advance(handle_,
+                            seen_);
+    }
+    void seen() noexcept {
+      ++seen_;
     }
   private:
     native_handle_type handle_;
-    ::io_uring_cqe&    cqe_;
+    unsigned           seen_;
   };
-  guard g(native_handle(),
-          cqe);
+  guard g(native_handle());
+  handle_cqe_type retr;
+  unsigned head;
+  ::io_uring_cqe* cqe;
+  io_uring_for_each_cqe(native_handle(), head, cqe) {
+    if (stopped()) {
+      retr.stopped = true;
+      return retr;
+    }
+    g.seen();
+    auto result = handle_cqe(*cqe);
+    retr.handlers += result.handlers;
+    if (result.stopped) {
+      retr.stopped = true;
+      return retr;
+    }
+    if (retr.handlers >= max) {
+      return retr;
+    }
+    restart_if(0,
+               q_started_);
+  }
+  return retr;
+}
+
+execution_context::handle_cqe_type execution_context::handle_cqe(const ::io_uring_cqe& cqe) {
+  assert(!stopped());
   handle_cqe_type retr;
   if (cqe.user_data == to_user_data(stop_started_)) {
     stop_started_ = false;
@@ -412,41 +1395,75 @@ execution_context::handle_cqe_type execution_context::handle_cqe(::io_uring_cqe&
     }
     restart(2,
             zero_started_);
-    assert(!stopped());
     return retr;
   }
   if (cqe.user_data == to_user_data(q_started_)) {
     q_started_ = false;
     assert(stopped());
-    auto pending = q_.pending();
-    assert(pending);
-    pending_ += pending;
-    retr.stopped = service_queue(1);
-    ++retr.handlers;
+    q_.acknowledge();
     return retr;
   }
-  from_user_data<completion>(cqe.user_data).complete(cqe);
+  if (cqe.user_data == to_user_data(q_)) {
+    //  Woken by a message from another ring (see notify)
+    return retr;
+  }
+  if (cqe.user_data & msg_ring_tag) {
+    //  A wake up message sent to another execution
+    //  context (see notify)
+    handle_msg_ring(cqe);
+    return retr;
+  }
+  if (cqe.user_data & detached_tag) {
+    //  See submit_detached
+    auto&& c = from_user_data<completion>(cqe.user_data & ~detached_tag);
+    delete &static_cast<detached_operation&>(c);
+    return retr;
+  }
+  auto copy = cqe;
+  if (!join_link(copy)) {
+    //  An operation or the timeout linked to it the
+    //  other of which is yet to complete
+    return retr;
+  }
+  from_user_data<completion>(copy.user_data).dispatch(copy);
   ++retr.handlers;
   return retr;
 }
 
-bool execution_context::service_queue(queue_type::integer_type max) {
-  assert(max <= pending_);
-  bool retr = false;
-  q_.consume(max,
-             [&](auto&& func) { --pending_;
-                                auto work = work_.fetch_sub(1,
-                                                            std::memory_order_acquire);
-                                assert(work);
-                                if (work == 1) {
-                                  retr = true;
-                                }
-                                func(); });
+template<typename Queue>
+execution_context::handle_cqe_type execution_context::service_queue(Queue& q,
+                                                                    count_type max)
+{
+  handle_cqe_type retr;
+  while ((retr.handlers < max) &&
+         q.consume_one([&](auto&& func) { ++retr.handlers;
+                                           auto work = work_.fetch_sub(1,
+                                                                       std::memory_order_acquire);
+                                           assert(work);
+                                           (void)work;
+                                           func(); }));
+  if (retr.handlers) {
+    retr.stopped = out_of_work();
+  }
   return retr;
 }
 
-bool execution_context::service_queue() {
-  return service_queue(pending_);
+execution_context::handle_cqe_type execution_context::service_queues(count_type max) {
+  //  Functions posted from within handlers which are
+  //  run here are deferred to the next pass so that
+  //  a handler which reposts itself cannot starve the
+  //  ring
+  auto retr = service_queue(local_,
+                            std::min<count_type>(max,
+                                                 local_.size()));
+  if (retr.stopped || (retr.handlers >= max)) {
+    return retr;
+  }
+  auto result = service_queue(q_,
+                              max - retr.handlers);
+  retr.handlers += result.handlers;
+  retr.stopped = result.stopped;
+  return retr;
 }
 
 }
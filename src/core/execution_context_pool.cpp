@@ -0,0 +1,50 @@
+#include <asio_uring/execution_context_pool.hpp>
+
+#include <cstddef>
+#include <system_error>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+namespace asio_uring::detail::execution_context_pool {
+
+void pin_this_thread(std::size_t i) {
+  ::cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (::sched_getaffinity(0,
+                          sizeof(allowed),
+                          &allowed))
+  {
+    std::error_code ec(errno,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+  auto count = CPU_COUNT(&allowed);
+  if (!count) {
+    return;
+  }
+  i %= std::size_t(count);
+  int cpu = 0;
+  for (;; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    if (!i) {
+      break;
+    }
+    --i;
+  }
+  ::cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int result = ::pthread_setaffinity_np(::pthread_self(),
+                                        sizeof(set),
+                                        &set);
+  if (result) {
+    std::error_code ec(result,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+}
@@ -0,0 +1,211 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "execution_context.hpp"
+#include "liburing.hpp"
+#include "spin_lock.hpp"
+
+namespace asio_uring {
+
+/**
+ *  A ring of buffers provided to the kernel
+ *  (`IORING_REGISTER_PBUF_RING`) from which operations
+ *  submitted with `IOSQE_BUFFER_SELECT` and the
+ *  corresponding buffer group select a buffer only
+ *  once data is available.
+ *
+ *  This allows any number of outstanding receive
+ *  operations to share a pool of buffers sized for
+ *  the data actually in flight rather than each
+ *  pinning a buffer for the lifetime of its wait.
+ *
+ *  The ring is owned by the caller rather than by
+ *  the \ref execution_context it is registered with.
+ *  Either may be destroyed first: If the execution
+ *  context is destroyed first closing its `io_uring`
+ *  unregisters the buffer group and the ring is
+ *  detached (its buffers and any outstanding
+ *  \ref lease "leases" remain valid until it is
+ *  destroyed). The two must not be destroyed
+ *  concurrently.
+ */
+class buffer_ring {
+friend class execution_context;
+public:
+  /**
+   *  An owning handle to a buffer selected by the
+   *  kernel which returns the buffer to the ring
+   *  when released or destroyed.
+   */
+  class lease {
+  friend class buffer_ring;
+  public:
+    /**
+     *  Creates a lease which owns no buffer.
+     */
+    lease() noexcept;
+    lease(const lease&) = delete;
+    lease& operator=(const lease&) = delete;
+    /**
+     *  Creates a lease by assuming ownership of the
+     *  buffer owned by another, leaving that lease
+     *  without a buffer.
+     *
+     *  \param [in] other
+     *    The lease from which to transfer ownership.
+     */
+    lease(lease&& other) noexcept;
+    /**
+     *  Releases the owned buffer (if any) and then
+     *  assumes ownership of the buffer owned by
+     *  another, leaving that lease without a buffer.
+     *
+     *  \param [in] rhs
+     *    The lease from which to transfer ownership.
+     *
+     *  \return
+     *    A reference to this object.
+     */
+    lease& operator=(lease&& rhs) noexcept;
+    /**
+     *  Calls \ref release.
+     */
+    ~lease() noexcept;
+    /**
+     *  Obtains a pointer to the data received into
+     *  the buffer.
+     *
+     *  \return
+     *    A pointer to the data or `nullptr` if this
+     *    lease owns no buffer.
+     */
+    void* data() const noexcept;
+    /**
+     *  Obtains the number of bytes received into the
+     *  buffer.
+     *
+     *  \return
+     *    The number of bytes.
+     */
+    std::size_t size() const noexcept;
+    /**
+     *  Determines whether this lease owns a buffer.
+     *
+     *  \return
+     *    `true` if so, `false` otherwise.
+     */
+    explicit operator bool() const noexcept;
+    /**
+     *  Returns the owned buffer (if any) to the ring.
+     *
+     *  Thread safe.
+     */
+    void release() noexcept;
+  private:
+    lease(buffer_ring&,
+          unsigned short,
+          std::size_t) noexcept;
+    buffer_ring*   ring_;
+    unsigned short id_;
+    std::size_t    size_;
+  };
+  buffer_ring() = delete;
+  buffer_ring(const buffer_ring&) = delete;
+  buffer_ring(buffer_ring&&) = delete;
+  buffer_ring& operator=(const buffer_ring&) = delete;
+  buffer_ring& operator=(buffer_ring&&) = delete;
+  /**
+   *  Allocates the buffers and registers them with
+   *  the `io_uring` of a certain \ref execution_context.
+   *
+   *  Throws on error.
+   *
+   *  \param [in] ctx
+   *    The \ref execution_context. This reference need
+   *    not remain valid for the lifetime of this object
+   *    (see above).
+   *  \param [in] group
+   *    The buffer group ID by which operations select
+   *    from this ring. Must be unique among the rings
+   *    registered with `ctx`.
+   *  \param [in] entries
+   *    The number of buffers. Must be a power of two no
+   *    greater than 32768.
+   *  \param [in] buffer_size
+   *    The size of each buffer in bytes.
+   */
+  buffer_ring(execution_context& ctx,
+              unsigned short group,
+              unsigned entries,
+              std::size_t buffer_size);
+  /**
+   *  Unregisters the ring (unless the execution
+   *  context has already been destroyed) and frees
+   *  the buffers.
+   *
+   *  All operations which select from the ring must
+   *  have completed and all \ref lease "leases" must
+   *  have been released or the behavior is undefined.
+   */
+  ~buffer_ring() noexcept;
+  /**
+   *  Obtains the buffer group ID.
+   *
+   *  \return
+   *    The ID.
+   */
+  unsigned short group() const noexcept;
+  /**
+   *  Obtains the number of buffers.
+   *
+   *  \return
+   *    The number of buffers.
+   */
+  unsigned entries() const noexcept;
+  /**
+   *  Obtains the size of each buffer.
+   *
+   *  \return
+   *    The size in bytes.
+   */
+  std::size_t buffer_size() const noexcept;
+  /**
+   *  Assumes ownership of the buffer the kernel
+   *  selected for a certain completion.
+   *
+   *  \param [in] cqe
+   *    The completion queue entry. If
+   *    `IORING_CQE_F_BUFFER` is not set the returned
+   *    lease owns no buffer.
+   *
+   *  \return
+   *    A \ref lease.
+   */
+  lease get(const ::io_uring_cqe& cqe) noexcept;
+private:
+  void recycle(unsigned short) noexcept;
+  void* buffer(unsigned short) const noexcept;
+  class unmap {
+  public:
+    explicit unmap(std::size_t) noexcept;
+    void operator()(::io_uring_buf_ring*) const noexcept;
+  private:
+    std::size_t size_;
+  };
+  using ring_type = std::unique_ptr<::io_uring_buf_ring,
+                                    unmap>;
+  execution_context*               ctx_;
+  const unsigned short             group_;
+  const unsigned                   entries_;
+  const std::size_t                buffer_size_;
+  std::unique_ptr<unsigned char[]> buffers_;
+  ring_type                        ring_;
+  spin_lock                        lock_;
+};
+
+}
@@ -142,11 +142,11 @@ public:
       inner_->destroy();
     }
   }
-  virtual R invoke(Args...) override {
+  virtual R invoke(Args... args) override {
     auto ptr = inner_;
     assert(ptr);
     inner_ = nullptr;
-    return ptr->invoke();
+    return ptr->invoke(std::forward<Args>(args)...);
   }
 private:
   indirect_base_type* inner_;
@@ -0,0 +1,64 @@
+/**
+ *  \file
+ *
+ *  Compile time configuration.
+ *
+ *  Each value may be overridden by defining the
+ *  corresponding macro. The CMake build defines each
+ *  macro from the cache variable of the same name on
+ *  the library's public interface so that the library
+ *  and its users always agree.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#ifndef ASIO_URING_FUNCTION_STORAGE_SIZE
+#define ASIO_URING_FUNCTION_STORAGE_SIZE 256
+#endif
+
+#ifndef ASIO_URING_COMPLETION_STORAGE_SIZE
+#define ASIO_URING_COMPLETION_STORAGE_SIZE 64
+#endif
+
+#ifndef ASIO_URING_REGISTERED_FILES
+#define ASIO_URING_REGISTERED_FILES 1024
+#endif
+
+namespace asio_uring::config {
+
+/**
+ *  The number of bytes of storage for a function
+ *  posted to an \ref asio_uring::execution_context
+ *  "execution_context" which is provided by the queue
+ *  itself. Larger functions are allocated using their
+ *  allocator.
+ */
+inline constexpr std::size_t function_storage_size = ASIO_URING_FUNCTION_STORAGE_SIZE;
+/**
+ *  The number of bytes of storage for a completion
+ *  handler provided by the smallest size class of
+ *  completion objects pooled by
+ *  \ref asio_uring::service "service". Each subsequent
+ *  size class provides four times as much.
+ */
+inline constexpr std::size_t completion_storage_size = ASIO_URING_COMPLETION_STORAGE_SIZE;
+/**
+ *  The number of size classes of completion objects
+ *  pooled by \ref asio_uring::service "service".
+ *  Completion handlers too large for the largest size
+ *  class are allocated using their allocator.
+ */
+inline constexpr std::size_t completion_size_classes = 3;
+/**
+ *  The number of slots each
+ *  \ref asio_uring::execution_context "execution_context"
+ *  reserves in its registered file table for
+ *  user file descriptors (see
+ *  \ref asio_uring::execution_context::register_file "register_file").
+ *  The table is further limited by `RLIMIT_NOFILE`.
+ */
+inline constexpr std::size_t registered_files = ASIO_URING_REGISTERED_FILES;
+
+}
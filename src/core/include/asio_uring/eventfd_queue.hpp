@@ -4,15 +4,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <memory>
-#include <mutex>
 #include <new>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include "eventfd.hpp"
-#include "spin_lock.hpp"
 
 namespace asio_uring {
 
@@ -20,6 +20,19 @@ namespace asio_uring {
  *  A concurrent queue which uses an \ref eventfd
  *  as the notification mechanism.
  *
+ *  Any number of threads may publish values
+ *  simultaneously but only one thread at a time may
+ *  consume them. Publication never blocks on other
+ *  publishers: Nodes are linked into an intrusive
+ *  lock free queue (after Dmitry Vyukov) and recycled
+ *  through a bounded lock free cache rather than
+ *  through lists guarded by locks.
+ *
+ *  The \ref eventfd is only written when the consumer
+ *  has announced that it is about to block (see
+ *  \ref sleep) so that publishing to a consumer which
+ *  is awake costs no system calls.
+ *
  *  \tparam T
  *    The element type.
  *  \tparam Allocator
@@ -57,16 +70,22 @@ private:
   using allocator_traits_type = std::allocator_traits<allocator_type>;
   using storage_type = std::aligned_union_t<1,
                                             value_type>;
-  class node_type {
+  static constexpr std::size_t cache_line_size = 64;
+  static constexpr std::size_t free_size = 128;
+  class link_type {
   public:
-    node_type() noexcept
+    link_type() noexcept
       : next(nullptr)
     {}
-    node_type(const node_type&) = delete;
-    node_type(node_type&&) = delete;
-    node_type& operator=(const node_type&) = delete;
-    node_type& operator=(node_type&&) = delete;
-    node_type*   next;
+    link_type(const link_type&) = delete;
+    link_type(link_type&&) = delete;
+    link_type& operator=(const link_type&) = delete;
+    link_type& operator=(link_type&&) = delete;
+    std::atomic<link_type*> next;
+  };
+  class node_type : public link_type {
+  public:
+    node_type() = default;
     storage_type storage;
     void reset() noexcept {
       get().~value_type();
@@ -96,25 +115,34 @@ public:
    */
   explicit eventfd_queue(const allocator_type& alloc = allocator_type())
     : Allocator(alloc),
-      head_    (nullptr),
-      tail_    (nullptr),
-      free_    (nullptr)
-  {}
+      sleeping_(false),
+      head_    (&stub_),
+      tail_    (&stub_),
+      free_push_(0),
+      free_pop_ (0)
+  {
+    for (std::size_t i = 0; i < free_size; ++i) {
+      free_[i].sequence.store(i,
+                              std::memory_order_relaxed);
+    }
+  }
   eventfd_queue(const eventfd_queue&) = delete;
   eventfd_queue(eventfd_queue&&) = delete;
   eventfd_queue& operator=(const eventfd_queue&) = delete;
   eventfd_queue& operator=(eventfd_queue&&) = delete;
 #ifndef ASIO_URING_DOXYGEN_RUNNING
   ~eventfd_queue() noexcept {
-    while (head_) {
-      auto node = head_;
-      head_ = head_->next;
-      node->reset();
-      destroy_node(node);
+    link_type* link = tail_;
+    while (link) {
+      auto next = link->next.load(std::memory_order_acquire);
+      if (link != &stub_) {
+        auto node = static_cast<node_type*>(link);
+        node->reset();
+        destroy_node(node);
+      }
+      link = next;
     }
-    while (free_) {
-      auto node = free_;
-      free_ = free_->next;
+    while (auto node = pop_free()) {
       destroy_node(node);
     }
   }
@@ -136,7 +164,8 @@ public:
    *  1. Inserting it into the queue via emplace
    *     construction
    *  2. Calling \ref eventfd::write on the
-   *     associated \ref eventfd.
+   *     associated \ref eventfd if and only if the
+   *     consumer is asleep (see \ref sleep)
    *
    *  Note that if \ref eventfd::write throws an
    *  exception the node remains in the queue.
@@ -151,25 +180,51 @@ public:
    */
   template<typename... Args>
   void emplace(Args&&... args) {
+    if (emplace_quietly(std::forward<Args>(args)...)) {
+      notify();
+    }
+  }
+  /**
+   *  Inserts a value into the queue via emplace
+   *  construction without waking the consumer.
+   *
+   *  If this function returns `true` the consumer is
+   *  asleep (see \ref sleep) and the caller assumes
+   *  responsibility for waking it, either by calling
+   *  \ref notify or by some other mechanism which
+   *  causes the consumer to stop blocking.
+   *
+   *  \tparam Args
+   *    The types of arguments to forward through
+   *    to a constructor of \ref value_type.
+   *
+   *  \param [in] args
+   *    The arguments to forward through to a
+   *    constructor of \ref value_type.
+   *
+   *  \return
+   *    `true` if the consumer must be woken, `false`
+   *    otherwise.
+   */
+  template<typename... Args>
+  bool emplace_quietly(Args&&... args) {
     auto&& node = get_node();
-    assert(!node.next);
     try {
       node.emplace(std::forward<Args>(args)...);
     } catch (...) {
       release_node(node);
       throw;
     }
-    {
-      std::scoped_lock l(lock_);
-      if (tail_) {
-        assert(head_);
-        tail_->next = &node;
-      } else {
-        assert(!head_);
-        head_ = &node;
-      }
-      tail_ = &node;
-    }
+    link(node);
+    return sleeping_.load(std::memory_order_seq_cst) &&
+           sleeping_.exchange(false,
+                              std::memory_order_seq_cst);
+  }
+  /**
+   *  Wakes the consumer by calling \ref eventfd::write
+   *  on the associated \ref eventfd.
+   */
+  void notify() {
     e_.write(1);
   }
   /**
@@ -177,7 +232,8 @@ public:
    *
    *  1. Inserting it into the queue by move
    *  2. Calling \ref eventfd::write on the
-   *     associated \ref eventfd.
+   *     associated \ref eventfd if and only if the
+   *     consumer is asleep (see \ref sleep)
    *
    *  Note that if \ref eventfd::write throws an
    *  exception the node remains in the queue.
@@ -189,61 +245,120 @@ public:
     emplace(std::move(v));
   }
   /**
-   *  Reads the count from the event file descriptor.
+   *  Announces that the consumer is about to block
+   *  waiting for the associated \ref eventfd to become
+   *  readable.
+   *
+   *  If this function returns `true` the next value
+   *  published will write to the \ref eventfd (thereby
+   *  waking the consumer). Producers do not otherwise
+   *  write to the \ref eventfd which means that a
+   *  consumer which does not call this function before
+   *  blocking may never be woken.
+   *
+   *  Only the consumer may call this function.
+   *
+   *  \return
+   *    `true` if the queue is empty and the consumer
+   *    may block, `false` if the consumer should consume
+   *    rather than block. If `false` is returned the
+   *    \ref eventfd may nonetheless become readable
+   *    spuriously.
+   */
+  bool sleep() noexcept {
+    sleeping_.store(true,
+                    std::memory_order_seq_cst);
+    if (empty()) {
+      return true;
+    }
+    sleeping_.store(false,
+                    std::memory_order_relaxed);
+    return false;
+  }
+  /**
+   *  Announces that the consumer is no longer blocked.
+   *
+   *  Only the consumer may call this function.
+   */
+  void wake() noexcept {
+    sleeping_.store(false,
+                    std::memory_order_relaxed);
+  }
+  /**
+   *  Reads the associated \ref eventfd thereby
+   *  clearing its readiness.
    *
-   *  \warning
-   *    \ref consume_all performs this internally.
-   *    Calling this function clears the count associated
-   *    with the event file descriptor and requires that
-   *    the caller manage the count and make appropriate
-   *    calls to \ref consume in order to consume objects
-   *    (unless the returned value is `0`).
+   *  Note that the returned value is the number of
+   *  times the consumer was woken, not the number of
+   *  values in the queue.
    *
    *  \return
    *    The count of the event file descriptor.
    */
-  integer_type pending() {
+  integer_type acknowledge() {
     return e_.read();
   }
   /**
-   *  Consumes objects from the queue.
+   *  Determines whether the queue is empty.
+   *
+   *  A queue into which a value is concurrently being
+   *  published is considered not to be empty (even
+   *  though \ref consume_one may not yet be able to
+   *  obtain that value).
    *
-   *  \warning
-   *    If this function is called with an `n` which is
-   *    greater than the number of objects actually in
-   *    the queue the result is undefined behavior. Therefore
-   *    this function must only be used with the value
-   *    returned by \ref pending or a value less than that
-   *    value. If a value less than that value is used
-   *    the caller must perform book keeping externally
-   *    from this class to ensure that this function is
-   *    never called with `n` arguments which sum to
-   *    greater than the sum of all values ever returned
-   *    by \ref pending.
+   *  Only the consumer may call this function.
+   *
+   *  \return
+   *    `true` if the queue is empty, `false` otherwise.
+   */
+  bool empty() const noexcept {
+    return (tail_ == &stub_) &&
+           (head_.load(std::memory_order_seq_cst) == &stub_);
+  }
+  /**
+   *  Consumes a single object from the queue if one
+   *  is available.
+   *
+   *  Only the consumer may call this function.
    *
    *  \tparam Function
    *    An object which is invocable with signature
    *    `void(value_type)`.
    *
-   *  \param [in] n
-   *    The number of objects to consume.
    *  \param [in] f
-   *    An object which shall be invoked with each
-   *    dequeued object. If invocation of this object
-   *    throws an exception the current object will have
-   *    been consumed (as will all previous objects)
-   *    but no subsequent objects.
+   *    An object which shall be invoked with the
+   *    dequeued object (if any). If invocation of this
+   *    object throws an exception the object will
+   *    have been consumed.
+   *
+   *  \return
+   *    `true` if an object was consumed, `false`
+   *    otherwise.
    */
   template<typename Function>
-  void consume(integer_type n,
-               Function f)
-  {
-    for (integer_type i = 0; i < n; ++i) {
-      consume_one(f);
+  bool consume_one(Function f) {
+    auto ptr = try_unlink();
+    if (!ptr) {
+      return false;
+    }
+    assert(ptr != &stub_);
+    auto&& node = *static_cast<node_type*>(ptr);
+    try {
+      f(node.get());
+    } catch (...) {
+      node.reset();
+      release_node(node);
+      throw;
     }
+    node.reset();
+    release_node(node);
+    return true;
   }
   /**
-   *  Consumes all objects currently in the queue.
+   *  Consumes objects from the queue until it is
+   *  empty.
+   *
+   *  Only the consumer may call this function.
    *
    *  \tparam Function
    *    An object which is invocable with signature
@@ -261,10 +376,11 @@ public:
    */
   template<typename Function>
   std::size_t consume_all(Function f) {
-    auto to_read = pending();
-    consume(to_read,
-            std::move(f));
-    return to_read;
+    std::size_t retr = 0;
+    while (consume_one(f)) {
+      ++retr;
+    }
+    return retr;
   }
   /**
    *  @{
@@ -284,40 +400,95 @@ public:
    *  @}
    */
 private:
-  template<typename Function>
-  void consume_one(Function f) {
-    auto&& node = pop_node();
-    try {
-      f(node.get());
-    } catch (...) {
-      node.reset();
-      release_node(node);
-      throw;
+  void link(link_type& l) noexcept {
+    l.next.store(nullptr,
+                 std::memory_order_relaxed);
+    auto prev = head_.exchange(&l,
+                               std::memory_order_seq_cst);
+    prev->next.store(&l,
+                     std::memory_order_release);
+  }
+  link_type* try_unlink() noexcept {
+    auto tail = tail_;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
     }
-    node.reset();
-    release_node(node);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    link(stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
   }
-  node_type& pop_node() noexcept {
-    std::scoped_lock l(lock_);
-    assert(head_);
-    assert(tail_);
-    auto&& retr = *head_;
-    head_ = head_->next;
-    if (!head_) {
-      tail_ = nullptr;
+  //  Bounded multi producer multi consumer queue (after
+  //  Dmitry Vyukov) of nodes available for reuse. Each
+  //  slot's sequence number encodes whether it is ready
+  //  to be pushed to or popped from which avoids the ABA
+  //  problem an intrusive lock free stack would have.
+  bool push_free(node_type& node) noexcept {
+    auto pos = free_push_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto&& slot = free_[pos % free_size];
+      auto seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (!diff) {
+        if (free_push_.compare_exchange_weak(pos,
+                                             pos + 1,
+                                             std::memory_order_relaxed))
+        {
+          slot.node = &node;
+          slot.sequence.store(pos + 1,
+                              std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = free_push_.load(std::memory_order_relaxed);
+      }
     }
-    return retr;
   }
-  node_type& get_node() {
-    {
-      std::scoped_lock l(free_lock_);
-      if (free_) {
-        auto&& retr = *free_;
-        free_ = free_->next;
-        retr.next = nullptr;
-        return retr;
+  node_type* pop_free() noexcept {
+    auto pos = free_pop_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto&& slot = free_[pos % free_size];
+      auto seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (!diff) {
+        if (free_pop_.compare_exchange_weak(pos,
+                                            pos + 1,
+                                            std::memory_order_relaxed))
+        {
+          auto retr = slot.node;
+          slot.sequence.store(pos + free_size,
+                              std::memory_order_release);
+          return retr;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = free_pop_.load(std::memory_order_relaxed);
       }
     }
+  }
+  node_type& get_node() {
+    if (auto ptr = pop_free()) {
+      return *ptr;
+    }
     rebound_allocator_type alloc(get_allocator());
     node_type* ptr = rebound_allocator_traits_type::allocate(alloc,
                                                              1);
@@ -333,9 +504,9 @@ private:
     return *ptr;
   }
   void release_node(node_type& node) noexcept {
-    std::scoped_lock l(free_lock_);
-    node.next = free_;
-    free_ = &node;
+    if (!push_free(node)) {
+      destroy_node(&node);
+    }
   }
   void destroy_node(node_type* ptr) noexcept {
     assert(ptr);
@@ -346,12 +517,19 @@ private:
                                               ptr,
                                               1);
   }
-  eventfd           e_;
-  mutable spin_lock lock_;
-  node_type*        head_;
-  node_type*        tail_;
-  mutable spin_lock free_lock_;
-  node_type*        free_;
+  class free_slot_type {
+  public:
+    std::atomic<std::size_t> sequence;
+    node_type*               node;
+  };
+  eventfd                                            e_;
+  link_type                                          stub_;
+  alignas(cache_line_size) std::atomic<bool>         sleeping_;
+  alignas(cache_line_size) std::atomic<link_type*>   head_;
+  alignas(cache_line_size) link_type*                tail_;
+  alignas(cache_line_size) std::atomic<std::size_t>  free_push_;
+  alignas(cache_line_size) std::atomic<std::size_t>  free_pop_;
+  free_slot_type                                     free_[free_size];
 };
 
 }
@@ -5,25 +5,54 @@
 #pragma once
 
 #include <atomic>
+#include <bitset>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <thread>
+#include <system_error>
 #include <type_traits>
 #include <utility>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/list_hook.hpp>
+#include <boost/intrusive/options.hpp>
 #include "callable_storage.hpp"
+#include "config.hpp"
 #include "eventfd.hpp"
 #include "eventfd_queue.hpp"
 #include "liburing.hpp"
+#include "local_queue.hpp"
 #include "uring.hpp"
+#include <sys/uio.h>
 
 namespace asio_uring {
 
+class buffer_ring;
+
 /**
  *  Models `ExecutionContext` on top of `io_uring`
  *  functionality.
+ *
+ *  When a function is posted to an execution context
+ *  which is blocked waiting for completions from a
+ *  thread which is running a different execution context
+ *  the blocked execution context is woken by an
+ *  `IORING_OP_MSG_RING` submitted to the ring of the
+ *  posting execution context rather than by writing to
+ *  an eventfd (falling back to the eventfd if the
+ *  kernel does not support `IORING_OP_MSG_RING`). The
+ *  posting execution context does not run out of work
+ *  until it has reaped the completion of each such
+ *  message and writes the eventfd on behalf of any
+ *  message which could not be delivered.
  */
 class execution_context {
+friend class buffer_ring;
 public:
   /**
    *  A base class for all operations which use raw
@@ -44,17 +73,132 @@ public:
    *  to ensure the lifetime of their completion objects
    *  is as required to avoid undefined behavior and
    *  memory leaks.
+   *
+   *  If the submission queue is full when an operation
+   *  is submitted via \ref submit(Function) the prepared
+   *  submission queue entry is copied into the completion
+   *  object to which its `::io_uring_sqe::user_data`
+   *  points and that object is parked until the
+   *  execution context is able to move the entry into
+   *  the ring. Destroying a parked completion object (or
+   *  passing it to \ref unpark) cancels the submission.
+   *  Accordingly a completion object which may be parked
+   *  must not be the target of more than one such
+   *  submission at a time.
+   *
+   *  By default the proactor dispatches a completion by
+   *  calling \ref complete. Derived classes which know
+   *  the concrete type of an operation when it is
+   *  initiated may instead install a function which the
+   *  proactor calls directly (see \ref set_dispatch)
+   *  thereby avoiding any further indirection.
    */
   class completion {
+  friend class execution_context;
   public:
-    completion() = default;
+    completion() noexcept;
+    /**
+     *  Copies the dispatch function of another completion
+     *  but not whether it is parked.
+     *
+     *  \param [in] other
+     *    The completion to copy.
+     */
+    completion(const completion& other) noexcept;
+    /**
+     *  Copies the dispatch function of another completion
+     *  but not whether it is parked.
+     *
+     *  \param [in] rhs
+     *    The completion to copy.
+     *
+     *  \return
+     *    A reference to this object.
+     */
+    completion& operator=(const completion& rhs) noexcept;
+    /**
+     *  Cancels the submission if this object is parked
+     *  (see \ref unpark).
+     */
+    ~completion() noexcept;
     virtual void complete(const ::io_uring_cqe& cqe) = 0;
+  protected:
+    /**
+     *  The type of function which dispatches a
+     *  completion.
+     */
+    using dispatch_type = void (*)(completion&,
+                                   const ::io_uring_cqe&);
+    /**
+     *  Replaces the function which the proactor calls
+     *  to dispatch this completion.
+     *
+     *  \param [in] func
+     *    The function.
+     */
+    void set_dispatch(dispatch_type func) noexcept {
+      dispatch_ = func;
+    }
+    /**
+     *  Dispatches this completion by calling the
+     *  installed function (see \ref set_dispatch).
+     *
+     *  \param [in] cqe
+     *    The completion queue entry.
+     */
+    void dispatch(const ::io_uring_cqe& cqe) {
+      dispatch_(*this,
+                cqe);
+    }
+  private:
+    static void virtual_dispatch(completion&,
+                                 const ::io_uring_cqe&);
+    using pending_hook_type = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+    dispatch_type             dispatch_;
+    pending_hook_type         hook_;
+    ::io_uring_sqe            sqe_;
+    const ::__kernel_timespec* timeout_;
+    execution_context*        owner_;
+    //  Whether the operation is linked to a timeout and
+    //  which of their completions have arrived along with
+    //  the result of the operation (see join_link)
+    unsigned char             link_;
+    std::int32_t              res_;
+    std::uint32_t             flags_;
   };
   /**
    *  The type used to represent a count of executed
    *  handlers.
    */
   using count_type = std::size_t;
+  /**
+   *  A snapshot of counters which describe how the
+   *  execution context has coped with load.
+   */
+  class statistics {
+  public:
+    /**
+     *  The number of times the completion queue was
+     *  found to have overflowed (`IORING_SQ_CQ_OVERFLOW`)
+     *  and the overflowed completions were flushed into
+     *  it by entering the kernel.
+     */
+    std::size_t cq_overflows;
+    /**
+     *  The number of completions the kernel has dropped
+     *  because they could not be posted to the completion
+     *  queue (i.e. the value of the kernel's `koverflow`
+     *  counter). Should always be zero on kernels which
+     *  support `IORING_FEAT_NODROP`.
+     */
+    unsigned cq_dropped;
+    /**
+     *  The number of operations which were parked by
+     *  \ref submit(Function) rather than placed directly
+     *  in the submission queue.
+     */
+    std::size_t parked;
+  };
   /**
    *  A type alias for \ref uring::native_handle_type.
    */
@@ -110,10 +254,22 @@ public:
       assert(ctx_);
       on_work_started();
       try {
-        ctx_->q_.emplace(std::forward<NullaryFunction>(function),
-                         alloc);
+        if (!ctx_->concurrent_ && ctx_->running_in_this_thread()) {
+          ctx_->local_.emplace(std::forward<NullaryFunction>(function),
+                               alloc);
+        } else {
+          if (ctx_->q_.emplace_quietly(std::forward<NullaryFunction>(function),
+                                       alloc))
+          {
+            ctx_->notify();
+          }
+          if (ctx_->concurrent_) {
+            ctx_->notify_idle();
+          }
+        }
       } catch (...) {
         on_work_finished();
+        throw;
       }
     }
   private:
@@ -128,13 +284,45 @@ public:
    *    See documentation for \ref uring::uring(unsigned,unsigned) "the corresponding constructor of uring".
    *  \param [in] flags
    *    See documentation for \ref uring::uring(unsigned,unsigned) "the corresponding constructor of uring".
+   *  \param [in] concurrency_hint
+   *    The number of threads expected to run the
+   *    execution context simultaneously. If this is
+   *    `1` (the default) at most one thread may run
+   *    the execution context at a time and no
+   *    synchronization is performed. Otherwise any
+   *    number of threads may call \ref run,
+   *    \ref run_one, \ref poll, and \ref poll_one
+   *    simultaneously (see \ref concurrent).
    */
   explicit execution_context(unsigned entries,
-                             unsigned flags = 0);
+                             unsigned flags = 0,
+                             std::size_t concurrency_hint = 1);
+  /**
+   *  Creates an execution_context by passing arguments
+   *  through to a constructor of \ref uring.
+   *
+   *  Note that if `IORING_SETUP_SINGLE_ISSUER` is
+   *  requested the execution context must be created,
+   *  run, and submitted to from a single thread and
+   *  therefore the concurrency hint must be `1`.
+   *
+   *  \param [in] entries
+   *    See documentation for \ref uring::uring(unsigned,::io_uring_params&) "the corresponding constructor of uring".
+   *  \param [in, out] params
+   *    See documentation for \ref uring::uring(unsigned,::io_uring_params&) "the corresponding constructor of uring".
+   *  \param [in] concurrency_hint
+   *    See documentation for \ref execution_context(unsigned,unsigned,std::size_t) "the corresponding constructor".
+   */
+  execution_context(unsigned entries,
+                    ::io_uring_params& params,
+                    std::size_t concurrency_hint = 1);
   execution_context(const execution_context&) = delete;
   execution_context(execution_context&&) = delete;
   execution_context& operator=(const execution_context&) = delete;
   execution_context& operator=(execution_context&&) = delete;
+#ifndef ASIO_URING_DOXYGEN_RUNNING
+  ~execution_context() noexcept;
+#endif
   /**
    *  Retrieves an \ref executor_type "executor" which
    *  submits work to this execution context.
@@ -162,9 +350,10 @@ public:
    *  itself a call to \ref restart is required.
    *
    *  \warning
-   *    This function is not thread safe: Multiple threads
-   *    may not call \ref run, \ref run_one, \ref poll, or
-   *    \ref poll_one simultaneously.
+   *    Unless the execution context is \ref concurrent
+   *    multiple threads may not call \ref run,
+   *    \ref run_one, \ref poll, or \ref poll_one
+   *    simultaneously.
    *
    *  \return
    *    The number of handlers run.
@@ -183,9 +372,10 @@ public:
    *  itself a call to \ref restart is required.
    *
    *  \warning
-   *    This function is not thread safe: Multiple threads
-   *    may not call \ref run, \ref run_one, \ref poll, or
-   *    \ref poll_one simultaneously.
+   *    Unless the execution context is \ref concurrent
+   *    multiple threads may not call \ref run,
+   *    \ref run_one, \ref poll, or \ref poll_one
+   *    simultaneously.
    *
    *  \return
    *    The number of handlers run.
@@ -204,9 +394,10 @@ public:
    *  itself a call to \ref restart is required.
    *
    *  \warning
-   *    This function is not thread safe: Multiple threads
-   *    may not call \ref run, \ref run_one, \ref poll, or
-   *    \ref poll_one simultaneously.
+   *    Unless the execution context is \ref concurrent
+   *    multiple threads may not call \ref run,
+   *    \ref run_one, \ref poll, or \ref poll_one
+   *    simultaneously.
    *
    *  \return
    *    The number of handlers run.
@@ -226,9 +417,10 @@ public:
    *  itself a call to \ref restart is required.
    *
    *  \warning
-   *    This function is not thread safe: Multiple threads
-   *    may not call \ref run, \ref run_one, \ref poll, or
-   *    \ref poll_one simultaneously.
+   *    Unless the execution context is \ref concurrent
+   *    multiple threads may not call \ref run,
+   *    \ref run_one, \ref poll, or \ref poll_one
+   *    simultaneously.
    *
    *  \return
    *    The number of handlers run.
@@ -270,33 +462,540 @@ public:
    *    thread, `false` otherwise.
    */
   bool running_in_this_thread() const noexcept;
+  /**
+   *  Determines whether the execution context may be
+   *  run by multiple threads simultaneously.
+   *
+   *  When this is the case completion queue entries are
+   *  reaped by one thread at a time (the leader) while
+   *  the handlers for those entries and posted functions
+   *  are run by all threads which are running the
+   *  execution context. Since the submission queue is
+   *  shared submission queue entries must be obtained,
+   *  prepared, and submitted atomically via
+   *  \ref submit(Function) rather than via \ref get_sqe
+   *  and \ref submit().
+   *
+   *  \return
+   *    `true` if the execution context was created with a
+   *    concurrency hint other than `1`, `false` otherwise.
+   */
+  bool concurrent() const noexcept;
+  /**
+   *  Retrieves the amount of outstanding work (i.e.
+   *  pending operations, queued functions, and
+   *  outstanding calls to \ref executor_type::on_work_started
+   *  "on_work_started" which have not been balanced by
+   *  calls to \ref executor_type::on_work_finished
+   *  "on_work_finished").
+   *
+   *  The value is a snapshot and may be out of date
+   *  by the time it is returned if other threads are
+   *  using the execution context.
+   *
+   *  \return
+   *    The amount of outstanding work.
+   */
+  std::size_t outstanding_work() const noexcept;
+  /**
+   *  Retrieves a snapshot of the \ref statistics
+   *  "statistics" for this execution context.
+   *
+   *  Thread safe.
+   *
+   *  \return
+   *    The statistics.
+   */
+  statistics stats() const noexcept;
+  /**
+   *  Determines whether new operations are throttled
+   *  while the completion queue has overflowed.
+   *
+   *  When enabled operations submitted via
+   *  \ref submit(Function) while the kernel reports
+   *  that the completion queue has overflowed are parked
+   *  rather than submitted so that completions already
+   *  generated are reaped before more are produced.
+   *  Parked operations are submitted once the overflow
+   *  has been cleared. Disabled by default.
+   *
+   *  Thread safe.
+   *
+   *  \param [in] enable
+   *    `true` to throttle, `false` otherwise.
+   */
+  void set_throttle_on_overflow(bool enable) noexcept;
+  /**
+   *  Determines whether the kernel supports a certain
+   *  `io_uring` operation as reported by
+   *  `IORING_REGISTER_PROBE` when this object was
+   *  created.
+   *
+   *  On kernels which cannot be probed no operation is
+   *  reported as supported.
+   *
+   *  Thread safe.
+   *
+   *  \param [in] opcode
+   *    The operation (e.g. `IORING_OP_RECV`).
+   *
+   *  \return
+   *    `true` if the operation is supported, `false`
+   *    otherwise.
+   */
+  bool opcode_supported(int opcode) const noexcept;
+  /**
+   *  Registers buffers with the ring
+   *  (`IORING_REGISTER_BUFFERS`) so that operations
+   *  such as `IORING_OP_READ_FIXED` and
+   *  `IORING_OP_WRITE_FIXED` may refer to them by index
+   *  which spares the kernel pinning and unpinning the
+   *  pages backing the buffers on every operation.
+   *
+   *  Only one set of buffers may be registered at a
+   *  time. Throws on error.
+   *
+   *  \param [in] iovs
+   *    A pointer to the buffers to register.
+   *  \param [in] n
+   *    The number of buffers.
+   */
+  void register_buffers(const ::iovec* iovs,
+                        unsigned n);
+  /**
+   *  Registers a table of `n` empty buffer slots which
+   *  may subsequently be populated by
+   *  \ref update_buffers.
+   *
+   *  Throws on error.
+   *
+   *  \param [in] n
+   *    The number of slots.
+   */
+  void register_buffers(unsigned n);
+  /**
+   *  Replaces some of the registered buffers (see
+   *  \ref register_buffers).
+   *
+   *  A buffer with a null base and zero length empties
+   *  the slot. Throws on error.
+   *
+   *  \param [in] offset
+   *    The index of the first buffer to replace.
+   *  \param [in] iovs
+   *    A pointer to the replacement buffers.
+   *  \param [in] n
+   *    The number of buffers to replace.
+   */
+  void update_buffers(unsigned offset,
+                      const ::iovec* iovs,
+                      unsigned n);
+  /**
+   *  Unregisters the registered buffers (see
+   *  \ref register_buffers).
+   *
+   *  Throws on error.
+   */
+  void unregister_buffers();
+  /**
+   *  Installs a file descriptor in a free slot of the
+   *  ring's registered file table
+   *  (`IORING_REGISTER_FILES_UPDATE`) so that operations
+   *  may refer to it by index by setting
+   *  `IOSQE_FIXED_FILE` which spares the kernel looking
+   *  up and reference counting the file on every
+   *  operation.
+   *
+   *  The table holds its own reference to the file
+   *  which is only released by \ref unregister_file.
+   *  Throws on error (in particular
+   *  `std::errc::too_many_files_open` if no slot is
+   *  free).
+   *
+   *  Thread safe.
+   *
+   *  \param [in] fd
+   *    The file descriptor.
+   *
+   *  \return
+   *    The index of the slot.
+   */
+  int register_file(int fd);
+  /**
+   *  Empties a slot populated by \ref register_file
+   *  and makes it available for reuse.
+   *
+   *  Throws on error.
+   *
+   *  Thread safe.
+   *
+   *  \param [in] index
+   *    The index of the slot.
+   */
+  void unregister_file(int index);
   /**
    *  Attempts to obtain a submission queue entry
    *  from the ring by calling `::io_uring_get_sqe`
    *  and checking the result for `nullptr`.
    *
+   *  If the submission queue is full entries which
+   *  have not yet been submitted are submitted and, if
+   *  the ring was created with `IORING_SETUP_SQPOLL`,
+   *  this function waits for the kernel thread to
+   *  consume entries.
+   *
    *  Throws if a submission queue entry could not
    *  be obtained (i.e. if `::io_uring_get_sqe` returns
-   *  `nullptr`).
+   *  `nullptr`). Use \ref submit(Function) to have
+   *  operations parked rather than failed when the
+   *  submission queue is full.
    *
    *  \return
    *    A reference to an `::io_uring_sqe`.
    */
   ::io_uring_sqe& get_sqe();
+  /**
+   *  Cancels the submission of an operation which was
+   *  parked by \ref submit(Function) and which has not
+   *  yet been moved into the ring. The operation will
+   *  therefore never complete.
+   *
+   *  \param [in] c
+   *    The \ref completion to which the parked entry's
+   *    `::io_uring_sqe::user_data` points.
+   *
+   *  \return
+   *    `true` if `c` was parked, `false` otherwise.
+   */
+  bool unpark(completion& c) noexcept;
+  /**
+   *  Submits all submission queue entries obtained
+   *  from the ring (see \ref get_sqe) which have not
+   *  yet been submitted.
+   *
+   *  If the execution context is running in this thread
+   *  (see \ref running_in_this_thread) submission is
+   *  deferred: Entries prepared while handlers run are
+   *  accumulated and submitted together (with a single
+   *  `io_uring_enter` which also waits for completions
+   *  when possible) before the execution context next
+   *  checks for completions and in any case before the
+   *  call to \ref run, \ref run_one, \ref poll, or
+   *  \ref poll_one returns.
+   *
+   *  Otherwise (or if the execution context is
+   *  \ref concurrent) the entries are submitted
+   *  immediately.
+   *
+   *  If the ring was created with `IORING_SETUP_SQPOLL`
+   *  (see \ref sqpoll_params) submission merely publishes
+   *  the entries to the kernel thread which polls the
+   *  submission queue and only enters the kernel if that
+   *  thread is asleep (`IORING_SQ_NEED_WAKEUP`).
+   *
+   *  Throws on error.
+   */
+  void submit();
+  /**
+   *  Obtains a submission queue entry (see \ref get_sqe),
+   *  invokes a function object to prepare it, and then
+   *  submits it (see \ref submit()).
+   *
+   *  If the execution context is \ref concurrent all
+   *  three steps are performed while holding the lock
+   *  which guards the submission queue.
+   *
+   *  If no submission queue entry can be obtained even
+   *  after unsubmitted entries have been submitted (or,
+   *  to preserve submission order, if operations are
+   *  already parked) the function object is instead
+   *  invoked with a temporary entry which is parked in
+   *  the \ref completion to which its
+   *  `::io_uring_sqe::user_data` points. Parked entries
+   *  are moved into the ring by \ref run, \ref run_one,
+   *  \ref poll, and \ref poll_one as completions free up
+   *  space in the submission queue. Operations are
+   *  also parked while the completion queue has
+   *  overflowed if the execution context has been
+   *  configured to do so (see
+   *  \ref set_throttle_on_overflow).
+   *
+   *  \tparam Function
+   *    A callable object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(::io_uring_sqe&) noexcept;
+   *    \endcode
+   *
+   *  \param [in] f
+   *    The function to use to prepare the submission
+   *    queue entry. Must set `::io_uring_sqe::user_data`
+   *    to the address of a \ref completion.
+   */
+  template<typename Function>
+  void submit(Function f) {
+    static_assert(noexcept(f(std::declval<::io_uring_sqe&>())));
+    auto l = lock();
+    auto sqe = (pending_.empty() && !throttled()) ? try_get_sqe() : nullptr;
+    if (!sqe) {
+      ::io_uring_sqe parked{};
+      f(parked);
+      park(parked);
+      return;
+    }
+    f(*sqe);
+    submit_impl();
+  }
+  /**
+   *  Obtains two consecutive submission queue entries,
+   *  invokes a function object to prepare the first,
+   *  links it to the second which is prepared as an
+   *  `IORING_OP_LINK_TIMEOUT`, and then submits both
+   *  (see \ref submit(Function)).
+   *
+   *  If the timeout elapses before the operation
+   *  completes the kernel cancels the operation. If the
+   *  operation completes with `-ECANCELED` as a result
+   *  the \ref completion is dispatched with `-ETIME`
+   *  instead so that expiry may be distinguished from
+   *  other cancellation. The completion for the timeout
+   *  itself is consumed internally and is not counted as
+   *  a handler and the \ref completion is not dispatched
+   *  until both have arrived.
+   *
+   *  Parking is as for \ref submit(Function) except
+   *  that parked operations are submitted together with
+   *  their timeout once two entries are available.
+   *  Accordingly throws if the submission queue has
+   *  fewer than two entries.
+   *
+   *  \tparam Function
+   *    A callable object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(::io_uring_sqe&) noexcept;
+   *    \endcode
+   *
+   *  \param [in] f
+   *    The function to use to prepare the submission
+   *    queue entry. Must set `::io_uring_sqe::user_data`
+   *    to the address of a \ref completion.
+   *  \param [in] timeout
+   *    The relative timeout. The kernel reads this when
+   *    the entries are submitted which may be after this
+   *    function returns. Accordingly this reference must
+   *    remain valid until the \ref completion is
+   *    dispatched or the behavior is undefined.
+   */
+  template<typename Function>
+  void submit(Function f,
+              const ::__kernel_timespec& timeout)
+  {
+    static_assert(noexcept(f(std::declval<::io_uring_sqe&>())));
+    if (u_.native_handle()->sq.ring_entries < 2) {
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
+    auto l = lock();
+    auto sqe = (pending_.empty() && !throttled()) ? try_get_sqe(2) : nullptr;
+    if (!sqe) {
+      ::io_uring_sqe parked{};
+      f(parked);
+      park(parked,
+           &timeout);
+      return;
+    }
+    f(*sqe);
+    link_timeout(*sqe,
+                 timeout);
+    submit_impl();
+  }
+  /**
+   *  Submits an operation which acts upon other
+   *  operations (e.g. `IORING_OP_ASYNC_CANCEL` or
+   *  `IORING_OP_TIMEOUT_REMOVE`) and the result of
+   *  which is therefore observed through the
+   *  completions of those operations.
+   *
+   *  The completion of the operation is consumed
+   *  internally: It is not counted as a handler and
+   *  the operation is not counted as work. The
+   *  execution context owns the storage for the
+   *  operation (allocated by this function) and
+   *  populates `::io_uring_sqe::user_data`
+   *  accordingly.
+   *
+   *  Parking and ordering are as for
+   *  \ref submit(Function). In particular the entry is
+   *  moved into the ring before any operation which
+   *  is submitted after this function returns.
+   *
+   *  \tparam Function
+   *    A callable object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(::io_uring_sqe&,
+   *         ::__kernel_timespec&) noexcept;
+   *    \endcode
+   *    Where the second argument is storage which
+   *    remains valid until the operation completes
+   *    (for use by operations which take a timeout).
+   *
+   *  \param [in] f
+   *    The function to use to prepare the submission
+   *    queue entry.
+   */
+  template<typename Function>
+  void submit_detached(Function f) {
+    static_assert(noexcept(f(std::declval<::io_uring_sqe&>(),
+                             std::declval<::__kernel_timespec&>())));
+    auto l = lock();
+    auto&& op = acquire_detached();
+    ::io_uring_sqe* sqe;
+    try {
+      sqe = (pending_.empty() && !throttled()) ? try_get_sqe() : nullptr;
+    } catch (...) {
+      delete &op;
+      throw;
+    }
+    if (!sqe) {
+      ::io_uring_sqe parked{};
+      f(parked,
+        op.timeout);
+      set_detached(parked,
+                   op);
+      park(parked);
+      return;
+    }
+    f(*sqe,
+      op.timeout);
+    set_detached(*sqe,
+                 op);
+    submit_impl();
+  }
+  /**
+   *  Defers submission (see \ref submit()) for the
+   *  lifetime of an instance so that many operations
+   *  initiated in succession enter the kernel with a
+   *  single `io_uring_enter`.
+   *
+   *  Entries are still submitted early if the
+   *  submission queue fills up. Once the last
+   *  outstanding instance is destroyed unsubmitted
+   *  entries are submitted unless submission would
+   *  be deferred anyway (i.e. unless the execution
+   *  context is running in this thread and is not
+   *  \ref concurrent).
+   */
+  class submission_batch {
+  public:
+    submission_batch() = delete;
+    submission_batch(const submission_batch&) = delete;
+    submission_batch(submission_batch&&) = delete;
+    submission_batch& operator=(const submission_batch&) = delete;
+    submission_batch& operator=(submission_batch&&) = delete;
+    /**
+     *  Begins deferring submission.
+     *
+     *  \param [in] ctx
+     *    The execution context. This reference must
+     *    remain valid for the lifetime of this object
+     *    or the behavior is undefined.
+     */
+    explicit submission_batch(execution_context& ctx);
+    /**
+     *  Ends deferring submission and submits any
+     *  unsubmitted entries as described above. Errors
+     *  are ignored (entries the kernel refuses remain
+     *  in the submission queue and are submitted by
+     *  \ref run and friends).
+     */
+    ~submission_batch() noexcept;
+  private:
+    execution_context& self_;
+  };
 private:
+  void initialize();
   bool out_of_work() const noexcept;
-  class tid_guard {
+  bool recover();
+  bool cq_ready();
+  bool throttled() const noexcept;
+  class flush_guard {
   public:
-    tid_guard() = delete;
-    tid_guard(const tid_guard&) = delete;
-    tid_guard(tid_guard&&) = delete;
-    tid_guard& operator=(const tid_guard&) = delete;
-    tid_guard& operator=(tid_guard&&) = delete;
-    explicit tid_guard(std::atomic<std::thread::id>&) noexcept;
-    ~tid_guard() noexcept;
+    flush_guard() = delete;
+    flush_guard(const flush_guard&) = delete;
+    flush_guard(flush_guard&&) = delete;
+    flush_guard& operator=(const flush_guard&) = delete;
+    flush_guard& operator=(flush_guard&&) = delete;
+    explicit flush_guard(execution_context&) noexcept;
+    ~flush_guard() noexcept(false);
   private:
-    std::atomic<std::thread::id>& tid_;
+    execution_context& self_;
+    int                exceptions_;
   };
+  std::unique_lock<std::mutex> lock() const;
+  ::io_uring_sqe* try_get_sqe(unsigned n = 1);
+  void link_timeout(::io_uring_sqe&,
+                    const ::__kernel_timespec&) noexcept;
+  bool join_link(::io_uring_cqe&) noexcept;
+  void submit_impl();
+  void flush();
+  void flush(std::error_code&) noexcept;
+  //  The storage for an operation submitted by
+  //  submit_detached which lives until its completion
+  //  is consumed (or the execution context is
+  //  destroyed)
+  class detached_operation : public completion {
+  public:
+    virtual void complete(const ::io_uring_cqe&) override;
+    using hook_type = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+    ::__kernel_timespec timeout;
+    hook_type           detached_hook;
+  };
+  detached_operation& acquire_detached();
+  static void set_detached(::io_uring_sqe&,
+                           detached_operation&) noexcept;
+  void park(const ::io_uring_sqe&,
+            const ::__kernel_timespec* = nullptr) noexcept;
+  void submit_pending();
+  void notify_idle();
+  void notify();
+  //  The target of wake up messages (see notify) which
+  //  outlives the execution context for as long as such
+  //  messages are outstanding
+  class wake_target {
+  public:
+    wake_target() = delete;
+    wake_target(const wake_target&) = delete;
+    wake_target(wake_target&&) = delete;
+    wake_target& operator=(const wake_target&) = delete;
+    wake_target& operator=(wake_target&&) = delete;
+    explicit wake_target(execution_context&) noexcept;
+    void acquire() noexcept;
+    static void release(wake_target*) noexcept;
+    static void detach(wake_target*) noexcept;
+    void notify();
+  private:
+    std::atomic<std::size_t> refs_;
+    std::mutex               mutex_;
+    execution_context*       self_;
+  };
+  void handle_msg_ring(const ::io_uring_cqe&);
+  class run_guard {
+  public:
+    run_guard() = delete;
+    run_guard(const run_guard&) = delete;
+    run_guard(run_guard&&) = delete;
+    run_guard& operator=(const run_guard&) = delete;
+    run_guard& operator=(run_guard&&) = delete;
+    explicit run_guard(execution_context&) noexcept;
+    ~run_guard() noexcept;
+    execution_context& context() const noexcept;
+    const run_guard* next() const noexcept;
+  private:
+    execution_context& self_;
+    const run_guard*   next_;
+  };
+  static thread_local const run_guard* top_;
   class handle_cqe_type {
   public:
     handle_cqe_type() noexcept;
@@ -308,28 +1007,73 @@ private:
   template<bool>
   count_type one_impl();
   template<bool>
-  handle_cqe_type impl();
+  handle_cqe_type impl(count_type);
+  template<bool>
+  count_type concurrent_impl(count_type);
+  template<bool>
+  bool lead(std::unique_lock<std::mutex>&);
+  void reap();
+  bool internal(const ::io_uring_cqe&) const noexcept;
+  void wait();
   bool stopped() const noexcept;
   void restart(std::size_t,
                bool&);
   void restart_if(std::size_t,
                   bool&);
-  handle_cqe_type handle_cqe(::io_uring_cqe&);
-  using function_type = callable_storage<256>;
+  handle_cqe_type handle_cqes(count_type);
+  handle_cqe_type handle_cqe(const ::io_uring_cqe&);
+  using pending_list_type = boost::intrusive::list<completion,
+                                                   boost::intrusive::member_hook<completion,
+                                                                                 completion::pending_hook_type,
+                                                                                 &completion::hook_>,
+                                                   boost::intrusive::constant_time_size<false>>;
+  using detached_list_type = boost::intrusive::list<detached_operation,
+                                                    boost::intrusive::member_hook<detached_operation,
+                                                                                  detached_operation::hook_type,
+                                                                                  &detached_operation::detached_hook>,
+                                                    boost::intrusive::constant_time_size<false>>;
+  using function_type = callable_storage<config::function_storage_size>;
   using queue_type = eventfd_queue<function_type>;
-  bool service_queue(queue_type::integer_type);
-  bool service_queue();
-  queue_type                   q_;
-  bool                         q_started_;
-  queue_type::integer_type     pending_;
-  eventfd                      stop_;
-  bool                         stop_started_;
-  eventfd                      zero_;
-  bool                         zero_started_;
-  std::atomic<std::size_t>     work_;
-  std::atomic<bool>            stopped_;
-  uring                        u_;
-  std::atomic<std::thread::id> tid_;
+  using local_queue_type = local_queue<function_type>;
+  template<typename Queue>
+  handle_cqe_type service_queue(Queue&,
+                                count_type);
+  handle_cqe_type service_queues(count_type);
+  queue_type                  q_;
+  bool                        q_started_;
+  local_queue_type            local_;
+  eventfd                     stop_;
+  bool                        stop_started_;
+  eventfd                     zero_;
+  bool                        zero_started_;
+  std::atomic<std::size_t>    work_;
+  std::atomic<bool>           stopped_;
+  bool                        unsubmitted_;
+  std::size_t                 batches_;
+  uring                       u_;
+  std::atomic<std::size_t>    runners_;
+  const bool                  concurrent_;
+  mutable std::mutex          mutex_;
+  std::condition_variable     cv_;
+  bool                        leader_;
+  std::atomic<std::size_t>    idle_;
+  std::deque<::io_uring_cqe>  ready_;
+  bool                        msg_ring_;
+  std::unique_ptr<wake_target,
+                  decltype(&wake_target::detach)> wake_;
+  pending_list_type           pending_;
+  detached_list_type          detached_;
+  std::atomic<bool>           throttle_;
+  std::atomic<std::size_t>    cq_overflows_;
+  std::atomic<std::size_t>    parked_;
+  std::mutex                  files_mutex_;
+  std::vector<int>            files_;
+  //  The rings which are registered with this execution
+  //  context and which must be detached from it if it
+  //  is destroyed first (see buffer_ring)
+  std::mutex                  buffer_rings_mutex_;
+  std::vector<buffer_ring*>   buffer_rings_;
+  std::bitset<256>            opcodes_;
 };
 
 }
@@ -0,0 +1,271 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "execution_context.hpp"
+
+namespace asio_uring {
+
+namespace detail::execution_context_pool {
+
+void pin_this_thread(std::size_t);
+
+}
+
+/**
+ *  Strategies by which a \ref basic_execution_context_pool
+ *  selects an execution context when an executor is
+ *  requested.
+ */
+enum class load_balancing {
+  /**
+   *  Each execution context is selected in turn.
+   */
+  round_robin,
+  /**
+   *  The execution context with the least outstanding
+   *  work (see \ref execution_context::outstanding_work)
+   *  is selected. Ties are broken in round robin order.
+   */
+  least_loaded
+};
+
+/**
+ *  A pool of execution contexts each of which owns
+ *  its own `io_uring` and is run by its own thread
+ *  (i.e. a shard per core).
+ *
+ *  Unlike a \ref execution_context::concurrent "concurrent"
+ *  \ref execution_context no state is shared between the
+ *  threads which run the pool: Each I/O object and each
+ *  operation belongs to exactly one execution context and
+ *  is only ever touched by the thread which runs it.
+ *
+ *  \tparam ExecutionContext
+ *    The type of execution context to pool. Must be
+ *    \ref execution_context or derived therefrom and
+ *    must be constructible from `unsigned` entries and
+ *    `unsigned` flags. Defaults to \ref execution_context.
+ */
+template<typename ExecutionContext = execution_context>
+class basic_execution_context_pool {
+public:
+  /**
+   *  A type alias for the template parameter to this
+   *  class template.
+   */
+  using context_type = ExecutionContext;
+  /**
+   *  The type of executor obtained from the pooled
+   *  execution contexts.
+   */
+  using executor_type = typename context_type::executor_type;
+  /**
+   *  A type alias for \ref execution_context::count_type.
+   */
+  using count_type = execution_context::count_type;
+  /**
+   *  The type used to represent the number of execution
+   *  contexts in the pool.
+   */
+  using size_type = std::size_t;
+  basic_execution_context_pool() = delete;
+  basic_execution_context_pool(const basic_execution_context_pool&) = delete;
+  basic_execution_context_pool(basic_execution_context_pool&&) = delete;
+  basic_execution_context_pool& operator=(const basic_execution_context_pool&) = delete;
+  basic_execution_context_pool& operator=(basic_execution_context_pool&&) = delete;
+  /**
+   *  Creates a pool of execution contexts.
+   *
+   *  \param [in] size
+   *    The number of execution contexts (and therefore
+   *    the number of threads which shall be used by
+   *    \ref run). Must be non-zero.
+   *  \param [in] entries
+   *    The number of entries for the `io_uring` of each
+   *    execution context.
+   *  \param [in] flags
+   *    The flags for the `io_uring` of each execution
+   *    context. Defaults to `0`.
+   *  \param [in] lb
+   *    The strategy used by \ref get_executor. Defaults
+   *    to \ref load_balancing::round_robin.
+   *  \param [in] pin
+   *    If `true` (the default) the thread which runs the
+   *    `i`th execution context is pinned to the `i`th CPU
+   *    (modulo the number of CPUs) on which the thread
+   *    calling \ref run is allowed to run.
+   */
+  basic_execution_context_pool(size_type size,
+                               unsigned entries,
+                               unsigned flags = 0,
+                               load_balancing lb = load_balancing::round_robin,
+                               bool pin = true)
+    : lb_  (lb),
+      pin_ (pin),
+      next_(0)
+  {
+    if (!size) {
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+    }
+    contexts_.reserve(size);
+    for (size_type i = 0; i < size; ++i) {
+      contexts_.push_back(std::make_unique<context_type>(entries,
+                                                         flags));
+    }
+  }
+  /**
+   *  Determines the number of execution contexts in
+   *  the pool.
+   *
+   *  \return
+   *    The number of execution contexts.
+   */
+  size_type size() const noexcept {
+    return contexts_.size();
+  }
+  /**
+   *  Retrieves a certain execution context.
+   *
+   *  \param [in] i
+   *    The index of the execution context. Must be less
+   *    than \ref size.
+   *
+   *  \return
+   *    A reference to the execution context.
+   */
+  context_type& context(size_type i) const noexcept {
+    assert(i < contexts_.size());
+    return *contexts_[i];
+  }
+  /**
+   *  Selects an execution context according to the
+   *  \ref load_balancing strategy with which the pool
+   *  was created and retrieves an executor for it.
+   *
+   *  Thread safe.
+   *
+   *  \return
+   *    An executor.
+   */
+  executor_type get_executor() noexcept {
+    auto start = next_.fetch_add(1,
+                                 std::memory_order_relaxed);
+    auto best = start % contexts_.size();
+    if (lb_ == load_balancing::least_loaded) {
+      auto work = contexts_[best]->outstanding_work();
+      for (size_type i = 1; (i < contexts_.size()) && work; ++i) {
+        auto candidate = (start + i) % contexts_.size();
+        auto candidate_work = contexts_[candidate]->outstanding_work();
+        if (candidate_work < work) {
+          best = candidate;
+          work = candidate_work;
+        }
+      }
+    }
+    return contexts_[best]->get_executor();
+  }
+  /**
+   *  Runs each execution context on its own thread
+   *  (see \ref execution_context::run) and waits for
+   *  all of them to return.
+   *
+   *  If any execution context throws all execution
+   *  contexts are stopped and, once all threads have
+   *  returned, the first exception is rethrown.
+   *
+   *  \return
+   *    The total number of handlers run.
+   */
+  count_type run() {
+    std::vector<count_type> counts(contexts_.size(),
+                                   0);
+    std::exception_ptr ex;
+    std::mutex m;
+    auto func = [&](size_type i) noexcept {
+      try {
+        if (pin_) {
+          detail::execution_context_pool::pin_this_thread(i);
+        }
+        counts[i] = contexts_[i]->run();
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> l(m);
+          if (!ex) {
+            ex = std::current_exception();
+          }
+        }
+        stop();
+      }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(contexts_.size());
+    try {
+      for (size_type i = 0; i < contexts_.size(); ++i) {
+        threads.emplace_back(func,
+                             i);
+      }
+    } catch (...) {
+      stop();
+      join(threads);
+      throw;
+    }
+    join(threads);
+    if (ex) {
+      std::rethrow_exception(ex);
+    }
+    count_type retr = 0;
+    for (auto count : counts) {
+      retr += count;
+    }
+    return retr;
+  }
+  /**
+   *  Invokes \ref execution_context::stop on each
+   *  execution context.
+   */
+  void stop() noexcept {
+    for (auto&& ctx : contexts_) {
+      ctx->stop();
+    }
+  }
+  /**
+   *  Invokes \ref execution_context::restart on each
+   *  execution context.
+   */
+  void restart() {
+    for (auto&& ctx : contexts_) {
+      ctx->restart();
+    }
+  }
+private:
+  static void join(std::vector<std::thread>& threads) noexcept {
+    for (auto&& t : threads) {
+      t.join();
+    }
+  }
+  using contexts_type = std::vector<std::unique_ptr<context_type>>;
+  contexts_type             contexts_;
+  load_balancing            lb_;
+  bool                      pin_;
+  std::atomic<size_type>    next_;
+};
+
+/**
+ *  A \ref basic_execution_context_pool of
+ *  \ref execution_context objects.
+ */
+using execution_context_pool = basic_execution_context_pool<>;
+
+}
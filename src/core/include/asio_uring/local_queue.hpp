@@ -0,0 +1,280 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace asio_uring {
+
+/**
+ *  A queue which is not safe for concurrent use
+ *  and which therefore requires no synchronization.
+ *
+ *  Nodes are retained after the objects they contain
+ *  are consumed and reused for subsequently published
+ *  objects so that a queue in a steady state does not
+ *  allocate. At most 128 such nodes are retained so that
+ *  a burst of publications does not hold memory
+ *  indefinitely: Beyond that consumed nodes are freed.
+ *
+ *  \tparam T
+ *    The element type.
+ *  \tparam Allocator
+ *    The `Allocator` type to use to customize the
+ *    allocation strategy. Defaults to
+ *    `std::allocator<T>`.
+ */
+template<typename T,
+         typename Allocator = std::allocator<T>>
+class local_queue : private Allocator {
+public:
+  /**
+   *  A type alias for the first template parameter to
+   *  this class template.
+   */
+  using value_type = T;
+  /**
+   *  A type alias for the second template parameter to
+   *  this class template.
+   */
+  using allocator_type = Allocator;
+  /**
+   *  The type used to represent the number of objects
+   *  in the queue.
+   */
+  using size_type = std::size_t;
+private:
+  using allocator_traits_type = std::allocator_traits<allocator_type>;
+  using storage_type = std::aligned_union_t<1,
+                                            value_type>;
+  static constexpr std::size_t free_size = 128;
+  class node_type {
+  public:
+    node_type() noexcept
+      : next(nullptr)
+    {}
+    node_type(const node_type&) = delete;
+    node_type(node_type&&) = delete;
+    node_type& operator=(const node_type&) = delete;
+    node_type& operator=(node_type&&) = delete;
+    node_type*   next;
+    storage_type storage;
+    void reset() noexcept {
+      get().~value_type();
+    }
+    template<typename... Args>
+    void emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<value_type,
+                                                                          Args...>)
+    {
+      new(&storage) value_type(std::forward<Args>(args)...);
+    }
+    value_type& get() noexcept {
+      return *reinterpret_cast<value_type*>(&storage);
+    }
+  };
+  using rebound_allocator_type = typename allocator_traits_type::template rebind_alloc<node_type>;
+  using rebound_allocator_traits_type = typename allocator_traits_type::template rebind_traits<node_type>;
+public:
+  /**
+   *  Creates an empty local_queue which uses a
+   *  certain instance of \ref allocator_type to
+   *  allocate storage.
+   *
+   *  \param [in] alloc
+   *    The instance of \ref allocator_type to use.
+   *    Defaults to `allocator_type()` (i.e. a
+   *    default constructed instance).
+   */
+  explicit local_queue(const allocator_type& alloc = allocator_type())
+    : Allocator(alloc),
+      head_    (nullptr),
+      tail_    (nullptr),
+      free_    (nullptr),
+      free_size_(0),
+      size_    (0)
+  {}
+  local_queue(const local_queue&) = delete;
+  local_queue(local_queue&&) = delete;
+  local_queue& operator=(const local_queue&) = delete;
+  local_queue& operator=(local_queue&&) = delete;
+#ifndef ASIO_URING_DOXYGEN_RUNNING
+  ~local_queue() noexcept {
+    while (head_) {
+      auto node = head_;
+      head_ = head_->next;
+      node->reset();
+      destroy_node(node);
+    }
+    while (free_) {
+      auto node = free_;
+      free_ = free_->next;
+      destroy_node(node);
+    }
+  }
+#endif
+  /**
+   *  Retrieves the specific instance of
+   *  \ref allocator_type associated with this
+   *  object.
+   *
+   *  \return
+   *    The `Allocator`.
+   */
+  allocator_type get_allocator() const noexcept {
+    return allocator_type(*this);
+  }
+  /**
+   *  Inserts a value at the back of the queue via
+   *  emplace construction.
+   *
+   *  \tparam Args
+   *    The types of arguments to forward through
+   *    to a constructor of \ref value_type.
+   *
+   *  \param [in] args
+   *    The arguments to forward through to a
+   *    constructor of \ref value_type.
+   */
+  template<typename... Args>
+  void emplace(Args&&... args) {
+    auto&& node = get_node();
+    try {
+      node.emplace(std::forward<Args>(args)...);
+    } catch (...) {
+      release_node(node);
+      throw;
+    }
+    if (tail_) {
+      assert(head_);
+      tail_->next = &node;
+    } else {
+      assert(!head_);
+      head_ = &node;
+    }
+    tail_ = &node;
+    ++size_;
+  }
+  /**
+   *  Inserts a value at the back of the queue by
+   *  move.
+   *
+   *  \param [in] v
+   *    The value to insert.
+   */
+  void push(value_type v) {
+    emplace(std::move(v));
+  }
+  /**
+   *  Determines whether the queue is empty.
+   *
+   *  \return
+   *    `true` if the queue is empty, `false` otherwise.
+   */
+  bool empty() const noexcept {
+    return !head_;
+  }
+  /**
+   *  Determines the number of objects in the queue.
+   *
+   *  \return
+   *    The number of objects.
+   */
+  size_type size() const noexcept {
+    return size_;
+  }
+  /**
+   *  Consumes the object at the front of the queue if
+   *  there is one.
+   *
+   *  \tparam Function
+   *    An object which is invocable with signature
+   *    `void(value_type)`.
+   *
+   *  \param [in] f
+   *    An object which shall be invoked with the
+   *    dequeued object (if any). If invocation of this
+   *    object throws an exception the object will
+   *    have been consumed.
+   *
+   *  \return
+   *    `true` if an object was consumed, `false`
+   *    otherwise.
+   */
+  template<typename Function>
+  bool consume_one(Function f) {
+    if (!head_) {
+      return false;
+    }
+    auto&& node = *head_;
+    head_ = head_->next;
+    if (!head_) {
+      tail_ = nullptr;
+    }
+    --size_;
+    try {
+      f(node.get());
+    } catch (...) {
+      node.reset();
+      release_node(node);
+      throw;
+    }
+    node.reset();
+    release_node(node);
+    return true;
+  }
+private:
+  node_type& get_node() {
+    if (free_) {
+      auto&& retr = *free_;
+      free_ = free_->next;
+      --free_size_;
+      retr.next = nullptr;
+      return retr;
+    }
+    rebound_allocator_type alloc(get_allocator());
+    node_type* ptr = rebound_allocator_traits_type::allocate(alloc,
+                                                             1);
+    try {
+      rebound_allocator_traits_type::construct(alloc,
+                                               ptr);
+    } catch (...) {
+      rebound_allocator_traits_type::deallocate(alloc,
+                                                ptr,
+                                                1);
+      throw;
+    }
+    return *ptr;
+  }
+  void release_node(node_type& node) noexcept {
+    if (free_size_ == free_size) {
+      destroy_node(&node);
+      return;
+    }
+    node.next = free_;
+    free_ = &node;
+    ++free_size_;
+  }
+  void destroy_node(node_type* ptr) noexcept {
+    assert(ptr);
+    rebound_allocator_type alloc(get_allocator());
+    rebound_allocator_traits_type::destroy(alloc,
+                                           ptr);
+    rebound_allocator_traits_type::deallocate(alloc,
+                                              ptr,
+                                              1);
+  }
+  node_type*  head_;
+  node_type*  tail_;
+  node_type*  free_;
+  std::size_t free_size_;
+  size_type   size_;
+};
+
+}
@@ -4,7 +4,12 @@
 
 #pragma once
 
-#include <optional>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -12,7 +17,7 @@
 #include <boost/intrusive/list_hook.hpp>
 #include <boost/intrusive/options.hpp>
 #include <boost/iterator/transform_iterator.hpp>
-#include "callable_storage.hpp"
+#include "config.hpp"
 #include "execution_context.hpp"
 #include "liburing.hpp"
 #include <sys/uio.h>
@@ -29,6 +34,16 @@ namespace asio_uring {
  *    accordance with the rules of Boost.Asio and the Networking
  *    TS
  *
+ *  Objects which derive from \ref execution_context::completion
+ *  are allocated in contiguous slabs which are retained
+ *  and reused. Each slab belongs to a size class (see
+ *  \ref config::completion_storage_size) and completion
+ *  handlers are stored in objects of the smallest size
+ *  class which can accommodate them. Slabs may be allocated up front (see
+ *  \ref service(execution_context&,std::size_t,std::size_t))
+ *  and idle slabs are returned once the number of idle
+ *  objects exceeds a configurable high water mark.
+ *
  *  Note that while this object models `IoObjectService`
  *  it does not model `Service` as this would require
  *  relying on Boost.Asio-specific classes and functionality.
@@ -37,32 +52,185 @@ class service {
 private:
   using hook_type = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
   using iovs_type = std::vector<::iovec>;
+  class slab;
+  static constexpr std::size_t size_classes = config::completion_size_classes;
+  static constexpr std::size_t storage_size(std::size_t size_class) noexcept {
+    return config::completion_storage_size << (size_class * 2);
+  }
+  //  The smallest size class whose storage can hold an
+  //  object of type T or size_classes if there is none
+  template<typename T>
+  static constexpr std::size_t size_class() noexcept {
+    if (alignof(T) > alignof(std::max_align_t)) {
+      return size_classes;
+    }
+    std::size_t retr = 0;
+    while ((retr < size_classes) && (sizeof(T) > storage_size(retr))) {
+      ++retr;
+    }
+    return retr;
+  }
+  //  Handlers which fit no size class are allocated and
+  //  a pointer thereto is stored in the smallest size
+  //  class
+  template<typename T>
+  static constexpr std::size_t acquire_size_class() noexcept {
+    auto retr = size_class<T>();
+    return (retr == size_classes) ? 0 : retr;
+  }
   class completion final : public execution_context::completion {
   friend class service;
   private:
-    using function_type = callable_storage<256,
-                                           void(::io_uring_cqe)>;
+    template<typename T,
+             typename Allocator>
+    class indirect {
+    public:
+      indirect(T t,
+               const Allocator& alloc) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                                std::is_nothrow_copy_constructible_v<Allocator>)
+        : alloc(alloc),
+          t    (std::move(t))
+      {}
+      Allocator alloc;
+      T         t;
+    };
+    template<typename T,
+             typename Allocator>
+    using indirect_allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<indirect<T,
+                                                                                                                Allocator>>;
+    template<typename T,
+             typename Allocator>
+    using indirect_traits_type = std::allocator_traits<indirect_allocator_type<T,
+                                                                               Allocator>>;
   public:
-    explicit completion(service&);
+    completion(service&,
+               slab&) noexcept;
     virtual void complete(const ::io_uring_cqe&) override;
     template<typename T,
              typename Allocator>
     void emplace(T&& t,
-                 const Allocator& alloc) noexcept(std::is_nothrow_constructible_v<function_type,
-                                                                                  T&&,
-                                                                                  const Allocator&>)
+                 const Allocator& alloc)
     {
-      assert(!wrapped_);
-      wrapped_.emplace(std::forward<T>(t),
-                       alloc);
+      using value_type = std::decay_t<T>;
+      assert(!destroy_);
+      assert(size_class() == acquire_size_class<value_type>());
+      //  The handler is stored in place and the function
+      //  the proactor calls on completion is specific to
+      //  its type so that dispatching a completion costs
+      //  a single indirect call
+      if constexpr (service::size_class<value_type>() != size_classes) {
+        new(storage()) value_type(std::forward<T>(t));
+        set_dispatch(&invoke<value_type>);
+        destroy_ = &destroy<value_type>;
+      } else {
+        using indirect_type = indirect<value_type,
+                                       Allocator>;
+        using traits_type = indirect_traits_type<value_type,
+                                                 Allocator>;
+        indirect_allocator_type<value_type,
+                                Allocator> rebound(alloc);
+        indirect_type* ptr = traits_type::allocate(rebound,
+                                                   1);
+        try {
+          traits_type::construct(rebound,
+                                 ptr,
+                                 std::forward<T>(t),
+                                 alloc);
+        } catch (...) {
+          traits_type::deallocate(rebound,
+                                  ptr,
+                                  1);
+          throw;
+        }
+        new(storage()) indirect_type*(ptr);
+        set_dispatch(&invoke_indirect<value_type,
+                                      Allocator>);
+        destroy_ = &destroy_indirect<value_type,
+                                     Allocator>;
+      }
       svc_.context().get_executor().on_work_started();
     }
     void reset() noexcept;
+    ::iovec* iovs(std::size_t);
   private:
+    std::size_t size_class() const noexcept;
+    void* storage() noexcept;
+    template<typename T>
+    T& get() noexcept {
+      return *std::launder(reinterpret_cast<T*>(storage()));
+    }
+    template<typename T>
+    static void invoke(execution_context::completion& base,
+                       const ::io_uring_cqe& cqe)
+    {
+      auto&& self = static_cast<completion&>(base);
+      assert(self.service_.is_linked());
+      //  A multishot operation remains armed (and the
+      //  completion in use by the kernel) until a CQE
+      //  without IORING_CQE_F_MORE arrives
+      if (cqe.flags & IORING_CQE_F_MORE) {
+        self.get<T>()(cqe);
+        return;
+      }
+      release_guard g(self.svc_,
+                      self);
+      self.get<T>()(cqe);
+    }
+    template<typename T>
+    static void destroy(completion& self) noexcept {
+      self.get<T>().~T();
+    }
+    template<typename T,
+             typename Allocator>
+    static void invoke_indirect(execution_context::completion& base,
+                                const ::io_uring_cqe& cqe)
+    {
+      auto&& self = static_cast<completion&>(base);
+      assert(self.service_.is_linked());
+      if (cqe.flags & IORING_CQE_F_MORE) {
+        self.get<indirect<T,
+                          Allocator>*>()->t(cqe);
+        return;
+      }
+      release_guard g(self.svc_,
+                      self);
+      //  Memory allocated with the handler's allocator is
+      //  freed before the handler is invoked
+      auto ptr = self.get<indirect<T,
+                                   Allocator>*>();
+      T t(std::move(ptr->t));
+      destroy_indirect<T,
+                       Allocator>(self);
+      self.destroy_ = &destroy_nothing;
+      t(cqe);
+    }
+    template<typename T,
+             typename Allocator>
+    static void destroy_indirect(completion& self) noexcept {
+      using traits_type = indirect_traits_type<T,
+                                               Allocator>;
+      auto ptr = self.get<indirect<T,
+                                   Allocator>*>();
+      indirect_allocator_type<T,
+                              Allocator> rebound(ptr->alloc);
+      traits_type::destroy(rebound,
+                           ptr);
+      traits_type::deallocate(rebound,
+                              ptr,
+                              1);
+    }
+    static void invoke_nothing(execution_context::completion&,
+                               const ::io_uring_cqe&);
+    static void destroy_nothing(completion&) noexcept;
+    //  Enough for the buffer sequences used by nearly
+    //  all operations so that they need not allocate
+    static constexpr std::size_t inline_iovs = 8;
     service&                     svc_;
+    slab&                        slab_;
     hook_type                    service_;
     hook_type                    implementation_;
-    std::optional<function_type> wrapped_;
+    void                       (*destroy_)(completion&) noexcept;
+    ::iovec                      inline_iovs_[inline_iovs];
     iovs_type                    iovs_;
   };
   template<hook_type(completion::*MemberPtr)>
@@ -72,6 +240,31 @@ private:
                                                                       MemberPtr>,
                                         boost::intrusive::constant_time_size<false>>;
   using implementation_list_type = list_t<&completion::implementation_>;
+  //  Each completion is followed immediately by the
+  //  storage for its completion handler the size of
+  //  which depends on the size class of the slab
+  class slab {
+  public:
+    static constexpr std::size_t size = 32;
+    slab(service&,
+         std::size_t);
+    slab(const slab&) = delete;
+    slab(slab&&) = delete;
+    slab& operator=(const slab&) = delete;
+    slab& operator=(slab&&) = delete;
+    ~slab() noexcept;
+    completion& operator[](std::size_t) noexcept;
+    static void* storage(completion&) noexcept;
+    const std::size_t size_class;
+    std::size_t       in_use;
+  private:
+    using storage_type = std::aligned_storage_t<alignof(std::max_align_t),
+                                                alignof(std::max_align_t)>;
+    static constexpr std::size_t header = ((sizeof(completion) + sizeof(storage_type) - 1) / sizeof(storage_type)) *
+                                          sizeof(storage_type);
+    std::size_t                     stride_;
+    std::unique_ptr<storage_type[]> storage_;
+  };
   class release_guard {
   public:
     release_guard(service&,
@@ -143,8 +336,21 @@ public:
    *    The \ref execution_context. This reference must remain
    *    valid for the lifetime of the newly-created object or
    *    the behavior is undefined.
+   *  \param [in] prewarm
+   *    The number of \ref execution_context::completion
+   *    objects of each size class (see \ref config::completion_size_classes)
+   *    to allocate immediately so that the first
+   *    operations initiated do not allocate. Rounded up to
+   *    a whole number of slabs. Defaults to `0`.
+   *  \param [in] high_water_mark
+   *    The number of idle \ref execution_context::completion
+   *    objects above which slabs which become entirely idle
+   *    are freed. Defaults to the largest value of
+   *    `std::size_t` (i.e. memory is never returned).
    */
-  explicit service(execution_context& ctx);
+  explicit service(execution_context& ctx,
+                   std::size_t prewarm = 0,
+                   std::size_t high_water_mark = std::numeric_limits<std::size_t>::max());
   service(const service&) = delete;
   service(service&&) = delete;
   service& operator=(const service&) = delete;
@@ -157,7 +363,11 @@ public:
    *
    *  Note that this does not cause all outstanding operations
    *  to complete, it merely causes them to do nothing when
-   *  they complete.
+   *  they complete. Operations which were parked by the
+   *  \ref execution_context (see
+   *  \ref execution_context::submit(Function) "submit")
+   *  and not yet submitted are cancelled (see
+   *  \ref execution_context::unpark "unpark").
    */
   void shutdown() noexcept;
   /**
@@ -166,6 +376,14 @@ public:
    *  A reference to the associated \ref execution_context.
    */
   execution_context& context() const noexcept;
+  /**
+   *  Determines the number of \ref execution_context::completion
+   *  objects currently allocated (whether idle or in use).
+   *
+   *  \return
+   *    The number of objects.
+   */
+  std::size_t capacity() const;
   /**
    *  Initializes a \ref implementation_type "handle".
    *
@@ -247,7 +465,11 @@ public:
    *    object and storage is always allocated with
    *    `alloc`. It is the responsibility of the caller
    *    of this function to honor the guarantees reganding
-   *    executor and allocator associations.
+   *    executor and allocator associations. If the
+   *    operation is multishot the completion handler is
+   *    invoked once for each CQE and is destroyed after
+   *    it is invoked for a CQE without
+   *    `IORING_CQE_F_MORE`.
    *  \tparam Allocator
    *    The type of allocator to use to allocate storage
    *    for the completion handler (if necessary).
@@ -271,19 +493,21 @@ public:
                 T&& t,
                 const Allocator& alloc)
   {
-    auto&& c = acquire(impl);
+    auto&& c = acquire(impl,
+                       acquire_size_class<std::decay_t<T>>());
     release_guard g(*this,
                     c);
     c.emplace(std::forward<T>(t),
               alloc);
-    auto&& sqe = ctx_.get_sqe();
-    void* user_data = &c;
-    static_assert(noexcept(f(sqe,
-                             user_data)));
-    f(sqe,
-      user_data);
-    submit(sqe,
-           c);
+    ctx_.submit([&](auto&& sqe) noexcept {
+      void* user_data = &c;
+      static_assert(noexcept(f(sqe,
+                               user_data)));
+      f(sqe,
+        user_data);
+      ::io_uring_sqe_set_data(&sqe,
+                              user_data);
+    });
     g.release();
   }
   /**
@@ -318,7 +542,11 @@ public:
    *    object and storage is always allocated with
    *    `alloc`. It is the responsibility of the caller
    *    of this function to honor the guarantees reganding
-   *    executor and allocator associations.
+   *    executor and allocator associations. If the
+   *    operation is multishot the completion handler is
+   *    invoked once for each CQE and is destroyed after
+   *    it is invoked for a CQE without
+   *    `IORING_CQE_F_MORE`.
    *  \tparam Allocator
    *    The type of allocator to use to allocate storage
    *    for the completion handler (if necessary).
@@ -347,39 +575,167 @@ public:
                 T&& t,
                 const Allocator& alloc)
   {
-    auto&& c = acquire(impl);
+    auto&& c = acquire(impl,
+                       acquire_size_class<std::decay_t<T>>());
+    release_guard g(*this,
+                    c);
+    auto ptr = c.iovs(iovs);
+    c.emplace(std::forward<T>(t),
+              alloc);
+    ctx_.submit([&](auto&& sqe) noexcept {
+      void* user_data = &c;
+      static_assert(noexcept(f(sqe,
+                               ptr,
+                               user_data)));
+      f(sqe,
+        ptr,
+        user_data);
+      ::io_uring_sqe_set_data(&sqe,
+                              user_data);
+    });
+    g.release();
+  }
+  /**
+   *  Initiates an operation against the `io_uring`
+   *  which the kernel cancels if it does not complete
+   *  within a certain time (see
+   *  \ref execution_context::submit(Function, const ::__kernel_timespec&)).
+   *
+   *  \tparam Function
+   *    See \ref initiate(implementation_type&, std::size_t, Function, T&&, const Allocator&).
+   *  \tparam T
+   *    See \ref initiate(implementation_type&, std::size_t, Function, T&&, const Allocator&).
+   *  \tparam Allocator
+   *    See \ref initiate(implementation_type&, std::size_t, Function, T&&, const Allocator&).
+   *
+   *  \param [in, out] impl
+   *    The \ref implementation_type "handle" to associate
+   *    the operation with.
+   *  \param [in] iovs
+   *    The number of `::iovec` objects to make available
+   *    from the managed pool via the second argument to
+   *    `f`.
+   *  \param [in] timeout
+   *    The relative timeout. This is copied into storage
+   *    owned by the operation.
+   *  \param [in] f
+   *    The function to use to initialize the submission
+   *    queue entry.
+   *  \param [in] t
+   *    The completion handler.
+   *  \param [in] alloc
+   *    The `Allocator`.
+   */
+  template<typename Function,
+           typename T,
+           typename Allocator>
+  void initiate(implementation_type& impl,
+                std::size_t iovs,
+                const ::__kernel_timespec& timeout,
+                Function f,
+                T&& t,
+                const Allocator& alloc)
+  {
+    static_assert(sizeof(::__kernel_timespec) <= sizeof(::iovec));
+    static_assert(alignof(::__kernel_timespec) <= alignof(::iovec));
+    auto&& c = acquire(impl,
+                       acquire_size_class<std::decay_t<T>>());
     release_guard g(*this,
                     c);
-    c.iovs_ = acquire(iovs);
+    //  The kernel reads the timeout when the entries are
+    //  submitted (which may be deferred) so it is kept
+    //  in an extra ::iovec which lives as long as the
+    //  operation
+    auto ptr = c.iovs(iovs + 1);
+    auto ts = new (ptr + iovs) ::__kernel_timespec(timeout);
     c.emplace(std::forward<T>(t),
               alloc);
-    auto&& sqe = ctx_.get_sqe();
-    void* user_data = &c;
-    static_assert(noexcept(f(sqe,
-                             c.iovs_.data(),
-                             user_data)));
-    f(sqe,
-      c.iovs_.data(),
-      user_data);
-    submit(sqe,
-           c);
+    ctx_.submit([&](auto&& sqe) noexcept {
+                  void* user_data = &c;
+                  static_assert(noexcept(f(sqe,
+                                           ptr,
+                                           user_data)));
+                  f(sqe,
+                    ptr,
+                    user_data);
+                  ::io_uring_sqe_set_data(&sqe,
+                                          user_data);
+                },
+                *ts);
     g.release();
   }
+  /**
+   *  Submits an operation (see \ref execution_context::submit_detached)
+   *  for each operation outstanding against a certain
+   *  \ref implementation_type "handle".
+   *
+   *  The lock which guards the \ref execution_context::completion
+   *  objects is held until every entry has been
+   *  prepared. Since entries enter the ring in order
+   *  none of those objects can be released and then
+   *  acquired by an unrelated operation which enters
+   *  the ring before the entry which targets it.
+   *  Accordingly a request prepared by `f` (e.g.
+   *  `IORING_OP_ASYNC_CANCEL`) affects only the
+   *  operations it targets even if other threads run a
+   *  \ref execution_context::concurrent "concurrent"
+   *  execution context.
+   *
+   *  \tparam Function
+   *    A callable object which is invocable with the
+   *    following signature:
+   *    \code
+   *    void(::io_uring_sqe&,
+   *         ::__kernel_timespec&,
+   *         const void*) noexcept;
+   *    \endcode
+   *    Where the first two arguments are as for
+   *    \ref execution_context::submit_detached and the
+   *    third is the `user_data` of the operation to
+   *    target.
+   *
+   *  \param [in] impl
+   *    The \ref implementation_type "handle".
+   *  \param [in] f
+   *    The function to use to prepare each submission
+   *    queue entry.
+   */
+  template<typename Function>
+  void submit_for_each(const implementation_type& impl,
+                       Function f)
+  {
+    auto l = lock();
+    for (auto&& c : impl.list_) {
+      const void* user_data = &c;
+      ctx_.submit_detached([&](auto&& sqe,
+                               auto&& timeout) noexcept
+                           {
+                             static_assert(noexcept(f(sqe,
+                                                      timeout,
+                                                      user_data)));
+                             f(sqe,
+                               timeout,
+                               user_data);
+                           });
+    }
+  }
 private:
-  completion& maybe_allocate();
-  completion& acquire(implementation_type&);
-  iovs_type acquire(iovs_type::size_type);
+  void allocate(std::size_t);
+  completion& maybe_allocate(std::size_t);
+  completion& acquire(implementation_type&,
+                      std::size_t);
   void release(completion&) noexcept;
-  void release(iovs_type&) noexcept;
-  void submit(::io_uring_sqe&,
-              completion&);
+  void release(slab&) noexcept;
+  std::unique_lock<std::mutex> lock() const;
   using list_type = list_t<&completion::service_>;
-  using iovs_cache_type = std::vector<iovs_type>;
-  void destroy_list(list_type&) noexcept;
+  using slabs_type = std::vector<std::unique_ptr<slab>>;
   execution_context& ctx_;
-  list_type          free_;
+  mutable std::mutex mutex_;
+  list_type          free_[size_classes];
+  std::size_t        free_size_;
+  const std::size_t  high_water_mark_;
   list_type          in_use_;
-  iovs_cache_type    iovs_cache_;
+  slabs_type         slabs_;
 };
 
 }
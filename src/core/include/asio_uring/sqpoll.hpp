@@ -0,0 +1,45 @@
+/**
+ *  \file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include "liburing.hpp"
+
+namespace asio_uring {
+
+/**
+ *  Creates `::io_uring_params` which request that the
+ *  submission queue be polled by a kernel thread
+ *  (`IORING_SETUP_SQPOLL`) so that submission does not
+ *  require a system call while that thread is awake.
+ *
+ *  The result may be further customized and is suitable
+ *  for use with \ref uring::uring(unsigned,::io_uring_params&)
+ *  and \ref execution_context::execution_context(unsigned,::io_uring_params&,std::size_t).
+ *
+ *  \param [in] idle
+ *    The amount of time the kernel thread shall spin
+ *    without work before going to sleep (after which
+ *    the next submission must wake it with a system
+ *    call).
+ *  \param [in] cpu
+ *    If provided the CPU to which the kernel thread
+ *    shall be pinned (`IORING_SETUP_SQ_AFF`). Defaults
+ *    to `std::nullopt` (i.e. not pinned).
+ *  \param [in] share
+ *    If not `nullptr` the ring whose kernel thread (and
+ *    worker pool) shall be shared rather than creating
+ *    a new one (`IORING_SETUP_ATTACH_WQ`). Defaults to
+ *    `nullptr`.
+ *
+ *  \return
+ *    The parameters.
+ */
+::io_uring_params sqpoll_params(std::chrono::milliseconds idle,
+                                std::optional<unsigned> cpu = std::nullopt,
+                                const ::io_uring* share = nullptr) noexcept;
+
+}
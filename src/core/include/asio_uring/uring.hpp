@@ -39,6 +39,32 @@ public:
    */
   explicit uring(unsigned entries,
                  unsigned flags = 0);
+  /**
+   *  Calls `::io_uring_queue_init_params` with the
+   *  provided arguments and throws `std::system_error`
+   *  wrapping the error if that fails.
+   *
+   *  This allows all aspects of the ring to be
+   *  configured (e.g. the size of the completion queue
+   *  via `IORING_SETUP_CQSIZE`, the submission queue
+   *  polling thread via `IORING_SETUP_SQPOLL`,
+   *  `::io_uring_params::sq_thread_cpu`, and
+   *  `::io_uring_params::sq_thread_idle`, sharing a
+   *  kernel worker pool via `IORING_SETUP_ATTACH_WQ`
+   *  and `::io_uring_params::wq_fd`, and flags such as
+   *  `IORING_SETUP_COOP_TASKRUN`).
+   *
+   *  \param [in] entries
+   *    See documentation for `::io_uring_queue_init_params`.
+   *  \param [in, out] params
+   *    See documentation for `::io_uring_queue_init_params`.
+   *    On return contains the parameters negotiated with
+   *    the kernel (e.g. the actual number of submission
+   *    and completion queue entries and the supported
+   *    features).
+   */
+  uring(unsigned entries,
+        ::io_uring_params& params);
   /**
    *  Calls `::io_uring_queue_exit`.
    */
@@ -54,7 +80,14 @@ public:
   const_native_handle_type native_handle() const noexcept;
   /**
    *  @}
+   *  Retrieves the features supported by the kernel
+   *  as reported when the ring was created (i.e. a
+   *  bitmask of `IORING_FEAT_*` values).
+   *
+   *  \return
+   *    The features.
    */
+  unsigned features() const noexcept;
 private:
   ::io_uring ring_;
 };
@@ -0,0 +1 @@
+#include <asio_uring/local_queue.hpp>
@@ -1,7 +1,11 @@
 #include <asio_uring/service.hpp>
 
+#include <algorithm>
 #include <cassert>
-#include <optional>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <system_error>
 #include <utility>
 #include <asio_uring/liburing.hpp>
@@ -10,25 +14,41 @@
 
 namespace asio_uring {
 
-service::completion::completion(service& svc)
-  : svc_    (svc)
+service::completion::completion(service& svc,
+                                slab& s) noexcept
+  : svc_    (svc),
+    slab_   (s),
+    destroy_(nullptr)
 {}
 
 void service::completion::complete(const ::io_uring_cqe& cqe) {
-  assert(service_.is_linked());
-  release_guard g(svc_,
-                  *this);
-  assert(wrapped_);
-  (*wrapped_)(cqe);
+  dispatch(cqe);
 }
 
 void service::completion::reset() noexcept {
-  if (wrapped_) {
-    wrapped_ = std::nullopt;
+  if (destroy_) {
+    destroy_(*this);
+    destroy_ = nullptr;
+    //  An operation which completes after its handler
+    //  was destroyed (see shutdown) must still release
+    //  this object
+    set_dispatch(&invoke_nothing);
     svc_.context().get_executor().on_work_finished();
   }
 }
 
+void service::completion::invoke_nothing(execution_context::completion& base,
+                                         const ::io_uring_cqe& cqe)
+{
+  auto&& self = static_cast<completion&>(base);
+  assert(self.service_.is_linked());
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    self.svc_.release(self);
+  }
+}
+
+void service::completion::destroy_nothing(completion&) noexcept {}
+
 service::release_guard::release_guard(service& self,
                                       completion& c) noexcept
   : self_(&self),
@@ -45,6 +65,54 @@ void service::release_guard::release() noexcept {
   self_ = nullptr;
 }
 
+::iovec* service::completion::iovs(std::size_t n) {
+  if (n <= inline_iovs) {
+    return inline_iovs_;
+  }
+  //  Storage for long buffer sequences is retained by
+  //  the completion and therefore pooled along with it
+  iovs_.resize(n);
+  return iovs_.data();
+}
+
+std::size_t service::completion::size_class() const noexcept {
+  return slab_.size_class;
+}
+
+void* service::completion::storage() noexcept {
+  return slab::storage(*this);
+}
+
+service::slab::slab(service& svc,
+                    std::size_t size_class)
+  : size_class(size_class),
+    in_use    (0),
+    stride_   (header + storage_size(size_class)),
+    storage_  (new storage_type[(stride_ * size) / sizeof(storage_type)])
+{
+  static_assert((config::completion_storage_size % sizeof(storage_type)) == 0);
+  for (std::size_t i = 0; i < size; ++i) {
+    new(&storage_[(stride_ * i) / sizeof(storage_type)]) completion(svc,
+                                                                    *this);
+  }
+}
+
+service::slab::~slab() noexcept {
+  assert(!in_use);
+  for (std::size_t i = 0; i < size; ++i) {
+    (*this)[i].~completion();
+  }
+}
+
+service::completion& service::slab::operator[](std::size_t i) noexcept {
+  assert(i < size);
+  return *std::launder(reinterpret_cast<completion*>(&storage_[(stride_ * i) / sizeof(storage_type)]));
+}
+
+void* service::slab::storage(completion& c) noexcept {
+  return reinterpret_cast<unsigned char*>(&c) + header;
+}
+
 service::implementation_type::to_const_void_pointer::result_type service::implementation_type::to_const_void_pointer::operator()(argument_type arg) const noexcept {
   return &arg;
 }
@@ -59,21 +127,44 @@ service::implementation_type::const_iterator service::implementation_type::end()
                         to_const_void_pointer());
 }
 
-service::service(execution_context& ctx)
-  : ctx_(ctx)
-{}
+service::service(execution_context& ctx,
+                 std::size_t prewarm,
+                 std::size_t high_water_mark)
+  : ctx_            (ctx),
+    free_size_      (0),
+    high_water_mark_(high_water_mark)
+{
+  for (std::size_t i = 0; i < size_classes; ++i) {
+    for (std::size_t j = 0; j < prewarm; j += slab::size) {
+      allocate(i);
+    }
+  }
+}
 
 service::~service() noexcept {
-  destroy_list(free_);
   for (auto&& completion : in_use_) {
     completion.reset();
   }
-  destroy_list(in_use_);
+  in_use_.clear();
+  for (auto&& free : free_) {
+    free.clear();
+  }
+  for (auto&& s : slabs_) {
+    s->in_use = 0;
+  }
 }
 
 void service::shutdown() noexcept {
-  for (auto&& completion : in_use_) {
-    completion.reset();
+  for (auto iter = in_use_.begin(); iter != in_use_.end();) {
+    auto&& c = *iter;
+    ++iter;
+    c.reset();
+    //  An operation which was parked rather than submitted
+    //  never completes so nothing else would release its
+    //  completion object
+    if (ctx_.unpark(c)) {
+      release(c);
+    }
   }
 }
 
@@ -81,11 +172,17 @@ execution_context& service::context() const noexcept {
   return ctx_;
 }
 
+std::size_t service::capacity() const {
+  auto l = lock();
+  return slabs_.size() * slab::size;
+}
+
 void service::construct(implementation_type& impl) {
   assert(impl.list_.empty());
 }
 
 void service::destroy(implementation_type& impl) noexcept {
+  auto l = lock();
   impl.list_.clear();
 }
 
@@ -93,6 +190,7 @@ void service::move_construct(implementation_type& impl,
                              implementation_type& src) noexcept
 {
   assert(impl.list_.empty());
+  auto l = lock();
   impl.list_ = std::move(src.list_);
 }
 
@@ -106,17 +204,34 @@ void service::move_assign(implementation_type& impl,
                  src);
 }
 
-service::completion& service::maybe_allocate() {
-  if (free_.empty()) {
-    return *new completion(*this);
+void service::allocate(std::size_t size_class) {
+  assert(size_class < size_classes);
+  slabs_.push_back(std::make_unique<slab>(*this,
+                                          size_class));
+  auto&& s = *slabs_.back();
+  for (std::size_t i = 0; i < slab::size; ++i) {
+    free_[size_class].push_back(s[i]);
+  }
+  free_size_ += slab::size;
+}
+
+service::completion& service::maybe_allocate(std::size_t size_class) {
+  auto&& free = free_[size_class];
+  if (free.empty()) {
+    allocate(size_class);
   }
-  auto&& retr = free_.front();
-  free_.pop_front();
+  auto&& retr = free.front();
+  free.pop_front();
+  --free_size_;
+  ++retr.slab_.in_use;
   return retr;
 }
 
-service::completion& service::acquire(implementation_type& impl) {
-  auto&& retr = maybe_allocate();
+service::completion& service::acquire(implementation_type& impl,
+                                      std::size_t size_class)
+{
+  auto l = lock();
+  auto&& retr = maybe_allocate(size_class);
   assert(!retr.implementation_.is_linked());
   assert(!retr.service_.is_linked());
   in_use_.push_front(retr);
@@ -124,59 +239,44 @@ service::completion& service::acquire(implementation_type& impl) {
   return retr;
 }
 
-service::iovs_type service::acquire(iovs_type::size_type s) {
-  if (iovs_cache_.empty()) {
-    iovs_type retr;
-    retr.resize(s);
-    return retr;
-  }
-  iovs_type retr(std::move(iovs_cache_.back()));
-  assert(retr.empty());
-  iovs_cache_.pop_back();
-  return retr;
-}
-
 void service::release(completion& c) noexcept {
   assert(c.service_.is_linked());
   c.reset();
-  release(c.iovs_);
+  auto l = lock();
   c.implementation_.unlink();
   c.service_.unlink();
-  free_.push_front(c);
-}
-
-void service::release(iovs_type& iovs) noexcept {
-  if (!iovs.capacity()) {
-    return;
+  free_[c.size_class()].push_front(c);
+  ++free_size_;
+  auto&& s = c.slab_;
+  assert(s.in_use);
+  if (!--s.in_use && (free_size_ > high_water_mark_)) {
+    release(s);
   }
-  iovs.clear();
-  try {
-    iovs_cache_.emplace_back();
-    using std::swap;
-    swap(iovs,
-         iovs_cache_.back());
-  } catch (...) {}
 }
 
-void service::submit(::io_uring_sqe& sqe,
-                     completion& c)
-{
-  ::io_uring_sqe_set_data(&sqe,
-                          &c);
-  auto result = ::io_uring_submit(ctx_.native_handle());
-  if (result < 0) {
-    std::error_code ec(errno,
-                       std::generic_category());
-    throw std::system_error(ec);
+std::unique_lock<std::mutex> service::lock() const {
+  //  Completions are released by whichever thread runs
+  //  them which may only differ from the thread which
+  //  acquired them when the execution context is
+  //  concurrent
+  if (!ctx_.concurrent()) {
+    return std::unique_lock<std::mutex>(mutex_,
+                                        std::defer_lock);
   }
+  return std::unique_lock<std::mutex>(mutex_);
 }
 
-void service::destroy_list(list_type& list) noexcept {
-  while (!list.empty()) {
-    auto&& front = list.front();
-    list.pop_front();
-    delete &front;
-  }
+void service::release(slab& s) noexcept {
+  //  Destroying the completions in the slab unlinks them
+  //  from the free list
+  free_size_ -= slab::size;
+  auto iter = std::find_if(slabs_.begin(),
+                           slabs_.end(),
+                           [&](const auto& ptr) noexcept { return ptr.get() == &s; });
+  assert(iter != slabs_.end());
+  std::swap(*iter,
+            slabs_.back());
+  slabs_.pop_back();
 }
 
 }
@@ -0,0 +1,31 @@
+#include <asio_uring/sqpoll.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <asio_uring/liburing.hpp>
+
+namespace asio_uring {
+
+::io_uring_params sqpoll_params(std::chrono::milliseconds idle,
+                                std::optional<unsigned> cpu,
+                                const ::io_uring* share) noexcept
+{
+  ::io_uring_params retr;
+  std::memset(&retr,
+              0,
+              sizeof(retr));
+  retr.flags = IORING_SETUP_SQPOLL;
+  retr.sq_thread_idle = unsigned(idle.count());
+  if (cpu) {
+    retr.flags |= IORING_SETUP_SQ_AFF;
+    retr.sq_thread_cpu = *cpu;
+  }
+  if (share) {
+    retr.flags |= IORING_SETUP_ATTACH_WQ;
+    retr.wq_fd = unsigned(share->ring_fd);
+  }
+  return retr;
+}
+
+}
@@ -0,0 +1,186 @@
+#include <asio_uring/buffer_ring.hpp>
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <asio_uring/execution_context.hpp>
+#include <asio_uring/fd.hpp>
+#include <asio_uring/liburing.hpp>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::tests {
+namespace {
+
+class completion : public execution_context::completion {
+public:
+  completion(execution_context& ctx,
+             std::optional<::io_uring_cqe>& cqe) noexcept
+    : ctx_(ctx),
+      cqe_(cqe)
+  {}
+  virtual void complete(const ::io_uring_cqe& cqe) override {
+    ctx_.get_executor().on_work_finished();
+    cqe_ = cqe;
+  }
+private:
+  execution_context&             ctx_;
+  std::optional<::io_uring_cqe>& cqe_;
+};
+
+std::optional<::io_uring_cqe> recv(execution_context& ctx,
+                                   const fd& file,
+                                   const buffer_ring& ring)
+{
+  std::optional<::io_uring_cqe> retr;
+  completion c(ctx,
+               retr);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_recv(&sqe,
+                         file.native_handle(),
+                         nullptr,
+                         0,
+                         0);
+    sqe.flags |= IOSQE_BUFFER_SELECT;
+    sqe.buf_group = ring.group();
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  ctx.restart();
+  ctx.run();
+  return retr;
+}
+
+TEST_CASE("buffer_ring invalid",
+          "[buffer_ring]")
+{
+  execution_context ctx(10);
+  CHECK_THROWS_AS(buffer_ring(ctx,
+                              0,
+                              3,
+                              16),
+                  std::system_error);
+  CHECK_THROWS_AS(buffer_ring(ctx,
+                              0,
+                              4,
+                              0),
+                  std::system_error);
+}
+
+TEST_CASE("buffer_ring lease",
+          "[buffer_ring]")
+{
+  int sockets[2];
+  REQUIRE(::socketpair(AF_UNIX,
+                       SOCK_STREAM,
+                       0,
+                       sockets) == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  execution_context ctx(10);
+  buffer_ring ring(ctx,
+                   1,
+                   1,
+                   16);
+  CHECK(ring.group() == 1);
+  CHECK(ring.entries() == 1);
+  CHECK(ring.buffer_size() == 16);
+  REQUIRE(::write(remote.native_handle(),
+                  "abcd",
+                  4) == 4);
+  auto cqe = recv(ctx,
+                  local,
+                  ring);
+  REQUIRE(cqe);
+  REQUIRE(cqe->res == 4);
+  auto lease = ring.get(*cqe);
+  REQUIRE(lease);
+  REQUIRE(lease.size() == 4);
+  CHECK(std::string_view(static_cast<const char*>(lease.data()),
+                         lease.size()) == "abcd");
+  //  The only buffer is leased so the ring is empty
+  REQUIRE(::write(remote.native_handle(),
+                  "efgh",
+                  4) == 4);
+  cqe = recv(ctx,
+             local,
+             ring);
+  REQUIRE(cqe);
+  CHECK(cqe->res == -ENOBUFS);
+  CHECK_FALSE(ring.get(*cqe));
+  auto moved = std::move(lease);
+  CHECK_FALSE(lease);
+  REQUIRE(moved);
+  moved.release();
+  CHECK_FALSE(moved);
+  CHECK(moved.data() == nullptr);
+  cqe = recv(ctx,
+             local,
+             ring);
+  REQUIRE(cqe);
+  REQUIRE(cqe->res == 4);
+  lease = ring.get(*cqe);
+  REQUIRE(lease);
+  CHECK(std::string_view(static_cast<const char*>(lease.data()),
+                         lease.size()) == "efgh");
+}
+
+TEST_CASE("buffer_ring group reusable after destruction",
+          "[buffer_ring]")
+{
+  execution_context ctx(10);
+  {
+    buffer_ring ring(ctx,
+                     1,
+                     1,
+                     16);
+    CHECK_THROWS_AS(buffer_ring(ctx,
+                                1,
+                                1,
+                                16),
+                    std::system_error);
+  }
+  buffer_ring ring(ctx,
+                   1,
+                   1,
+                   16);
+}
+
+TEST_CASE("buffer_ring outlives execution_context",
+          "[buffer_ring]")
+{
+  int sockets[2];
+  REQUIRE(::socketpair(AF_UNIX,
+                       SOCK_STREAM,
+                       0,
+                       sockets) == 0);
+  fd local(sockets[0]);
+  fd remote(sockets[1]);
+  auto ctx = std::make_unique<execution_context>(10);
+  buffer_ring ring(*ctx,
+                   1,
+                   1,
+                   16);
+  REQUIRE(::write(remote.native_handle(),
+                  "abcd",
+                  4) == 4);
+  auto cqe = recv(*ctx,
+                  local,
+                  ring);
+  REQUIRE(cqe);
+  REQUIRE(cqe->res == 4);
+  auto lease = ring.get(*cqe);
+  REQUIRE(lease);
+  ctx.reset();
+  CHECK(std::string_view(static_cast<const char*>(lease.data()),
+                         lease.size()) == "abcd");
+  lease.release();
+}
+
+}
+}
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <stdexcept>
 #include <thread>
+#include <utility>
 #include <vector>
 #include <asio_uring/eventfd.hpp>
 #include <asio_uring/liburing.hpp>
@@ -98,7 +99,7 @@ TEST_CASE("eventfd_queue push & consume_all",
   CHECK(s.destroy == 2);
 }
 
-TEST_CASE("eventfd_queue pending",
+TEST_CASE("eventfd_queue consume_one",
           "[eventfd_queue][eventfd]")
 {
   using allocator_type = test::allocator<int>;
@@ -118,10 +119,8 @@ TEST_CASE("eventfd_queue pending",
     CHECK(s.construct == 2);
     CHECK(s.deallocate == 0);
     CHECK(s.destroy == 0);
-    auto pending = queue.pending();
-    REQUIRE(pending == 2);
-    queue.consume(1,
-                  [&](auto i) { consumed.push_back(i); });
+    REQUIRE_FALSE(queue.empty());
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
     CHECK(s.allocate == 2);
     CHECK(s.construct == 2);
     CHECK(s.deallocate == 0);
@@ -131,8 +130,7 @@ TEST_CASE("eventfd_queue pending",
     CHECK(*iter == 1);
     ++iter;
     CHECK(iter == consumed.end());
-    queue.consume(1,
-                  [&](auto i) { consumed.push_back(i); });
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
     CHECK(s.allocate == 2);
     CHECK(s.construct == 2);
     CHECK(s.deallocate == 0);
@@ -145,6 +143,8 @@ TEST_CASE("eventfd_queue pending",
     CHECK(*iter == 2);
     ++iter;
     CHECK(iter == consumed.end());
+    CHECK(queue.empty());
+    CHECK_FALSE(queue.consume_one([&](auto i) { consumed.push_back(i); }));
   }
   CHECK(s.allocate == 2);
   CHECK(s.construct == 2);
@@ -172,14 +172,12 @@ TEST_CASE("eventfd_queue exception",
     CHECK(s.construct == 2);
     CHECK(s.deallocate == 0);
     CHECK(s.destroy == 0);
-    auto pending = queue.pending();
-    REQUIRE(pending == 2);
+    REQUIRE_FALSE(queue.empty());
     auto func = [&](auto i) {
       consumed.push_back(i);
       throw std::runtime_error("foo");
     };
-    CHECK_THROWS_AS(queue.consume(1,
-                                  func),
+    CHECK_THROWS_AS(queue.consume_one(func),
                     std::runtime_error);
     CHECK(s.allocate == 2);
     CHECK(s.construct == 2);
@@ -190,8 +188,7 @@ TEST_CASE("eventfd_queue exception",
     CHECK(*iter == 1);
     ++iter;
     CHECK(iter == consumed.end());
-    queue.consume(1,
-                  [&](auto i) { consumed.push_back(i); });
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
     CHECK(s.allocate == 2);
     CHECK(s.construct == 2);
     CHECK(s.deallocate == 0);
@@ -211,6 +208,54 @@ TEST_CASE("eventfd_queue exception",
   CHECK(s.destroy == 2);
 }
 
+TEST_CASE("eventfd_queue multiple producers",
+          "[eventfd_queue][eventfd]")
+{
+  using allocator_type = test::allocator<std::pair<std::size_t,
+                                                   std::size_t>>;
+  allocator_type::state_type s;
+  allocator_type a(s);
+  constexpr std::size_t producers = 4;
+  constexpr std::size_t per_producer = 10000;
+  {
+    eventfd_queue<std::pair<std::size_t,
+                            std::size_t>,
+                  allocator_type> queue(a);
+    std::vector<std::thread> ts;
+    for (std::size_t i = 0; i < producers; ++i) {
+      ts.emplace_back([&, i]() {
+        for (std::size_t j = 0; j < per_producer; ++j) {
+          queue.emplace(i,
+                        j);
+        }
+      });
+    }
+    std::vector<std::size_t> next(producers,
+                                  0);
+    std::size_t consumed = 0;
+    bool ordered = true;
+    while (consumed != producers * per_producer) {
+      consumed += queue.consume_all([&](auto p) {
+        if (next[p.first] != p.second) {
+          ordered = false;
+        }
+        next[p.first] = p.second + 1;
+      });
+    }
+    for (auto&& t : ts) {
+      t.join();
+    }
+    CHECK(ordered);
+    for (auto n : next) {
+      CHECK(n == per_producer);
+    }
+  }
+  CHECK(s.allocate != 0);
+  CHECK(s.construct == s.allocate);
+  CHECK(s.deallocate == s.allocate);
+  CHECK(s.destroy == s.construct);
+}
+
 TEST_CASE("eventfd & uring polling",
           "[eventfd_queue][eventfd]")
 {
@@ -219,11 +264,12 @@ TEST_CASE("eventfd & uring polling",
   using allocator_type = test::allocator<int>;
   allocator_type::state_type s;
   allocator_type a(s);
+  constexpr std::size_t produced = 100000;
   {
     eventfd_queue<int,
                   allocator_type> queue(a);
-    std::atomic<std::size_t> produced(0);
     std::atomic<std::size_t> consumed(0);
+    std::atomic<std::size_t> wakeups(0);
     std::thread t([&]() {
       ::io_uring_sqe* sqe = ::io_uring_get_sqe(u.native_handle());
       CHECK(sqe);
@@ -234,6 +280,13 @@ TEST_CASE("eventfd & uring polling",
                                e.native_handle(),
                                POLLIN);
       for (;;) {
+        consumed += queue.consume_all([&](auto&&) {});
+        if (consumed == produced) {
+          return;
+        }
+        if (!queue.sleep()) {
+          continue;
+        }
         ::io_uring_sqe* sqe = ::io_uring_get_sqe(u.native_handle());
         CHECK(sqe);
         if (!sqe) {
@@ -242,10 +295,13 @@ TEST_CASE("eventfd & uring polling",
         ::io_uring_prep_poll_add(sqe,
                                  queue.native_handle(),
                                  POLLIN);
+        ::io_uring_sqe_set_data(sqe,
+                                &queue);
         ::io_uring_submit(u.native_handle());
         ::io_uring_cqe* cqe;
         int result = ::io_uring_wait_cqe(u.native_handle(),
                                          &cqe);
+        queue.wake();
         CHECK(result >= 0);
         if (result < 0) {
           return;
@@ -253,10 +309,8 @@ TEST_CASE("eventfd & uring polling",
         if (!cqe->user_data) {
           return;
         }
-        consumed += queue.consume_all([&](auto&&) {});
-        if (consumed == produced) {
-          return;
-        }
+        ++wakeups;
+        queue.acknowledge();
         ::io_uring_cqe_seen(u.native_handle(),
                             cqe);
       }
@@ -278,10 +332,11 @@ TEST_CASE("eventfd & uring polling",
     };
     guard g(t,
             e);
-    for (std::size_t i = 0; i < 100000; ++i) {
+    for (std::size_t i = 0; i < produced; ++i) {
       queue.emplace(1);
     }
     while (produced != consumed);
+    CHECK(wakeups <= produced);
   }
   CHECK(s.allocate != 0);
   CHECK(s.construct == s.allocate);
@@ -289,5 +344,47 @@ TEST_CASE("eventfd & uring polling",
   CHECK(s.destroy == s.construct);
 }
 
+TEST_CASE("eventfd_queue sleep",
+          "[eventfd_queue][eventfd]")
+{
+  eventfd_queue<int> queue;
+  CHECK(queue.empty());
+  CHECK(queue.sleep());
+  queue.emplace(1);
+  queue.emplace(2);
+  CHECK(queue.acknowledge() == 1);
+  CHECK_FALSE(queue.sleep());
+  CHECK(queue.consume_all([](auto) {}) == 2);
+  CHECK(queue.empty());
+  CHECK(queue.sleep());
+  queue.wake();
+  queue.emplace(3);
+  CHECK(queue.consume_all([](auto) {}) == 1);
+}
+
+TEST_CASE("eventfd_queue emplace_quietly",
+          "[eventfd_queue][eventfd]")
+{
+  eventfd_queue<int> queue;
+  CHECK_FALSE(queue.emplace_quietly(1));
+  CHECK(queue.consume_all([](auto) {}) == 1);
+  CHECK(queue.sleep());
+  CHECK(queue.emplace_quietly(2));
+  CHECK_FALSE(queue.emplace_quietly(3));
+  ::pollfd pfd;
+  pfd.fd = queue.native_handle();
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  CHECK(::poll(&pfd,
+               1,
+               0) == 0);
+  queue.notify();
+  CHECK(::poll(&pfd,
+               1,
+               0) == 1);
+  CHECK(queue.acknowledge() == 1);
+  CHECK(queue.consume_all([](auto) {}) == 2);
+}
+
 }
 }
@@ -1,15 +1,26 @@
 #include <asio_uring/execution_context.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <system_error>
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
+#include <asio_uring/fd.hpp>
 #include <asio_uring/liburing.hpp>
+#include <boost/asio/defer.hpp>
 #include <boost/asio/post.hpp>
 #include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include <catch2/catch.hpp>
 
@@ -207,6 +218,145 @@ TEST_CASE("execution_context executor_type boost::asio::post",
   CHECK(invoked);
 }
 
+TEST_CASE("execution_context executor_type post from other threads",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  constexpr std::size_t threads = 4;
+  constexpr std::size_t per_thread = 1000;
+  std::size_t invoked = 0;
+  ctx.get_executor().on_work_started();
+  std::atomic<std::size_t> remaining(threads);
+  std::vector<std::thread> ts;
+  for (std::size_t i = 0; i < threads; ++i) {
+    ts.emplace_back([&]() {
+      for (std::size_t j = 0; j < per_thread; ++j) {
+        boost::asio::post(ctx.get_executor(),
+                          [&]() { ++invoked; });
+        if (!(j % 100)) {
+          std::this_thread::yield();
+        }
+      }
+      if (!--remaining) {
+        ctx.get_executor().on_work_finished();
+      }
+    });
+  }
+  auto handlers = ctx.run();
+  for (auto&& t : ts) {
+    t.join();
+  }
+  CHECK(handlers == (threads * per_thread));
+  CHECK(invoked == (threads * per_thread));
+}
+
+TEST_CASE("execution_context executor_type post from another execution_context",
+          "[execution_context]")
+{
+  execution_context a(100);
+  execution_context b(100);
+  constexpr std::size_t posts = 100;
+  std::atomic<std::size_t> invoked(0);
+  std::atomic<bool> inside(true);
+  b.get_executor().on_work_started();
+  std::optional<execution_context::count_type> handlers;
+  std::thread t([&]() { handlers = b.run(); });
+  auto func = [&]() {
+    if (!b.running_in_this_thread()) {
+      inside = false;
+    }
+    if (++invoked == posts) {
+      b.get_executor().on_work_finished();
+    }
+  };
+  for (std::size_t i = 0; i < posts; ++i) {
+    boost::asio::post(a.get_executor(),
+                      [&]() { //  Give b time to block so that
+                              //  it must be woken
+                              std::this_thread::sleep_for(std::chrono::microseconds(100));
+                              boost::asio::post(b.get_executor(),
+                                                func); });
+  }
+  auto a_handlers = a.run();
+  t.join();
+  CHECK(a_handlers >= posts);
+  REQUIRE(handlers);
+  CHECK(*handlers == posts);
+  CHECK(invoked == posts);
+  CHECK(inside);
+}
+
+TEST_CASE("execution_context executor_type post from an execution_context which then runs out of work",
+          "[execution_context]")
+{
+  execution_context a(10);
+  execution_context b(10);
+  std::atomic<bool> invoked(false);
+  b.get_executor().on_work_started();
+  std::optional<execution_context::count_type> handlers;
+  std::thread t([&]() { handlers = b.run(); });
+  //  Give b time to block so that it must be woken
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  boost::asio::post(a.get_executor(),
+                    [&]() { boost::asio::post(b.get_executor(),
+                                              [&]() { invoked = true;
+                                                      b.get_executor().on_work_finished(); }); });
+  //  The completion of the wake up message on a's ring
+  //  is not a handler
+  auto a_handlers = a.run();
+  CHECK(a_handlers == 1);
+  CHECK(a.outstanding_work() == 0);
+  t.join();
+  REQUIRE(handlers);
+  CHECK(*handlers == 1);
+  CHECK(invoked);
+}
+
+TEST_CASE("execution_context executor_type post within handler",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::vector<int> invoked;
+  auto func = [&]() {
+    invoked.push_back(0);
+    boost::asio::post(ctx.get_executor(),
+                      [&]() { invoked.push_back(1); });
+    boost::asio::defer(ctx.get_executor(),
+                       [&]() { invoked.push_back(2); });
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  auto handlers = ctx.poll();
+  CHECK(handlers == 3);
+  REQUIRE(invoked.size() == 3);
+  CHECK(invoked[0] == 0);
+  CHECK(invoked[1] == 1);
+  CHECK(invoked[2] == 2);
+}
+
+TEST_CASE("execution_context executor_type post within handler run_one",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  bool inner = false;
+  auto func = [&]() {
+    boost::asio::post(ctx.get_executor(),
+                      [&]() { inner = true; });
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  auto handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  CHECK_FALSE(inner);
+  ctx.restart();
+  handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  CHECK(inner);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 0);
+}
+
 TEST_CASE("execution_context poll",
           "[execution_context]")
 {
@@ -355,6 +505,164 @@ TEST_CASE("execution_context completion",
   CHECK(cqe->flags == 0);
 }
 
+class counting_completion : public execution_context::completion {
+public:
+  counting_completion(execution_context& ctx,
+                      std::size_t& count) noexcept
+    : ctx_  (ctx),
+      count_(count)
+  {}
+  virtual void complete(const ::io_uring_cqe&) override {
+    ctx_.get_executor().on_work_finished();
+    ++count_;
+  }
+private:
+  execution_context& ctx_;
+  std::size_t&       count_;
+};
+
+class direct_completion : public execution_context::completion {
+public:
+  direct_completion(execution_context& ctx,
+                    std::size_t& count) noexcept
+    : ctx_  (ctx),
+      count_(count)
+  {
+    set_dispatch(&direct);
+  }
+  virtual void complete(const ::io_uring_cqe&) override {
+    FAIL("Dispatched virtually");
+  }
+private:
+  static void direct(execution_context::completion& base,
+                     const ::io_uring_cqe&)
+  {
+    auto&& self = static_cast<direct_completion&>(base);
+    self.ctx_.get_executor().on_work_finished();
+    ++self.count_;
+  }
+  execution_context& ctx_;
+  std::size_t&       count_;
+};
+
+TEST_CASE("execution_context completion set_dispatch",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::size_t count = 0;
+  direct_completion c(ctx,
+                      count);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+}
+
+TEST_CASE("execution_context submit",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &c);
+  ctx.get_executor().on_work_started();
+  ctx.submit();
+  CHECK(::io_uring_sq_ready(ctx.native_handle()) == 0);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+}
+
+TEST_CASE("execution_context submit deferred within handler",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  std::optional<unsigned> ready;
+  auto func = [&]() {
+    for (std::size_t i = 0; i < 5; ++i) {
+      auto&& sqe = ctx.get_sqe();
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &c);
+      ctx.get_executor().on_work_started();
+      ctx.submit();
+    }
+    ready = ::io_uring_sq_ready(ctx.native_handle());
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  auto handlers = ctx.run();
+  CHECK(handlers == 6);
+  CHECK(count == 5);
+  REQUIRE(ready);
+  CHECK(*ready == 5);
+}
+
+TEST_CASE("execution_context submit deferred within handler flushed by run_one",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  auto func = [&]() {
+    auto&& sqe = ctx.get_sqe();
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+    ctx.get_executor().on_work_started();
+    ctx.submit();
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  auto handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  CHECK(count == 0);
+  CHECK(::io_uring_sq_ready(ctx.native_handle()) == 0);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+}
+
+TEST_CASE("execution_context completions batch",
+          "[execution_context]")
+{
+  execution_context ctx(100);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  for (std::size_t i = 0; i < 3; ++i) {
+    auto&& sqe = ctx.get_sqe();
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+    ctx.get_executor().on_work_started();
+  }
+  ctx.submit();
+  auto handlers = ctx.run_one();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+  CHECK(::io_uring_cq_ready(ctx.native_handle()) == 2);
+  ctx.restart();
+  handlers = ctx.poll();
+  CHECK(handlers == 2);
+  CHECK(count == 3);
+  CHECK(::io_uring_cq_ready(ctx.native_handle()) == 0);
+}
+
 TEST_CASE("execution_context get_sqe") {
   execution_context ctx(1);
   ctx.get_sqe();
@@ -370,6 +678,547 @@ TEST_CASE("execution_context get_sqe") {
                                                         std::generic_category()).default_error_condition());
 }
 
+class ordered_completion : public execution_context::completion {
+public:
+  ordered_completion(execution_context& ctx,
+                     std::vector<int>& order,
+                     int id) noexcept
+    : ctx_  (ctx),
+      order_(order),
+      id_   (id)
+  {}
+  virtual void complete(const ::io_uring_cqe&) override {
+    ctx_.get_executor().on_work_finished();
+    order_.push_back(id_);
+  }
+private:
+  execution_context& ctx_;
+  std::vector<int>&  order_;
+  int                id_;
+};
+
+TEST_CASE("execution_context submit parks when submission queue is full",
+          "[execution_context]")
+{
+  execution_context ctx(1);
+  std::vector<int> order;
+  ordered_completion a(ctx,
+                       order,
+                       1);
+  ordered_completion b(ctx,
+                       order,
+                       2);
+  ordered_completion c(ctx,
+                       order,
+                       3);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &a);
+  ctx.get_executor().on_work_started();
+  for (auto ptr : {&b, &c}) {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              ptr);
+    });
+  }
+  CHECK(::io_uring_sq_ready(ctx.native_handle()) == 1);
+  ctx.submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 3);
+  CHECK(order == std::vector<int>{1, 2, 3});
+}
+
+TEST_CASE("execution_context submit parked completion destroyed",
+          "[execution_context]")
+{
+  execution_context ctx(1);
+  std::vector<int> order;
+  ordered_completion a(ctx,
+                       order,
+                       1);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &a);
+  ctx.get_executor().on_work_started();
+  {
+    ordered_completion b(ctx,
+                         order,
+                         2);
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &b);
+    });
+    CHECK(ctx.stats().parked == 1);
+  }
+  ordered_completion c(ctx,
+                       order,
+                       3);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  CHECK(ctx.unpark(c));
+  CHECK_FALSE(ctx.unpark(c));
+  ctx.get_executor().on_work_finished();
+  ctx.submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(order == std::vector<int>{1});
+}
+
+TEST_CASE("execution_context submit with timeout",
+          "[execution_context]")
+{
+  int pipes[2];
+  REQUIRE(::pipe(pipes) == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  execution_context ctx(2);
+  std::optional<::io_uring_cqe> cqe;
+  completion c(ctx,
+               cqe);
+  ::__kernel_timespec ts{};
+  ts.tv_nsec = 10000000;
+  auto submit = [&]() {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+                 ::io_uring_prep_poll_add(&sqe,
+                                          read.native_handle(),
+                                          POLLIN);
+                 ::io_uring_sqe_set_data(&sqe,
+                                         &c);
+               },
+               ts);
+  };
+  submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res == -ETIME);
+  cqe = std::nullopt;
+  ts.tv_sec = 10;
+  ts.tv_nsec = 0;
+  submit();
+  char ch = 'A';
+  REQUIRE(::write(write.native_handle(),
+                  &ch,
+                  sizeof(ch)) == 1);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res > 0);
+}
+
+TEST_CASE("execution_context concurrent submit with timeout",
+          "[execution_context]")
+{
+  int pipes[2];
+  REQUIRE(::pipe(pipes) == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  execution_context ctx(4,
+                        0,
+                        2);
+  std::optional<::io_uring_cqe> a_cqe;
+  completion a(ctx,
+               a_cqe);
+  std::optional<::io_uring_cqe> b_cqe;
+  completion b(ctx,
+               b_cqe);
+  ::__kernel_timespec a_ts{};
+  a_ts.tv_nsec = 10000000;
+  ::__kernel_timespec b_ts{};
+  b_ts.tv_sec = 10;
+  auto submit = [&](auto&& c,
+                    auto&& ts)
+  {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+                 ::io_uring_prep_poll_add(&sqe,
+                                          read.native_handle(),
+                                          POLLIN);
+                 ::io_uring_sqe_set_data(&sqe,
+                                         &c);
+               },
+               ts);
+  };
+  submit(a,
+         a_ts);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(a_cqe);
+  CHECK(a_cqe->res == -ETIME);
+  CHECK(a_cqe->user_data == reinterpret_cast<std::uintptr_t>(&a));
+  submit(b,
+         b_ts);
+  char ch = 'A';
+  REQUIRE(::write(write.native_handle(),
+                  &ch,
+                  sizeof(ch)) == 1);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(b_cqe);
+  CHECK(b_cqe->res > 0);
+}
+
+TEST_CASE("execution_context submit with timeout parks when submission queue is full",
+          "[execution_context]")
+{
+  execution_context ctx(2);
+  std::vector<int> order;
+  ordered_completion a(ctx,
+                       order,
+                       1);
+  ordered_completion b(ctx,
+                       order,
+                       2);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &a);
+  ctx.get_executor().on_work_started();
+  ::__kernel_timespec ts{};
+  ts.tv_sec = 10;
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+               ::io_uring_prep_nop(&sqe);
+               ::io_uring_sqe_set_data(&sqe,
+                                       &b);
+             },
+             ts);
+  CHECK(ctx.stats().parked == 1);
+  CHECK(::io_uring_sq_ready(ctx.native_handle()) == 1);
+  ctx.submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 2);
+  CHECK(order == std::vector<int>{1, 2});
+}
+
+TEST_CASE("execution_context submit with timeout requires two entries",
+          "[execution_context]")
+{
+  execution_context ctx(1);
+  std::optional<::io_uring_cqe> cqe;
+  completion c(ctx,
+               cqe);
+  ::__kernel_timespec ts{};
+  CHECK_THROWS_AS(ctx.submit([&](auto&& sqe) noexcept {
+                               ::io_uring_prep_nop(&sqe);
+                               ::io_uring_sqe_set_data(&sqe,
+                                                       &c);
+                             },
+                             ts),
+                  std::system_error);
+}
+
+TEST_CASE("execution_context submit_detached",
+          "[execution_context]")
+{
+  int pipes[2];
+  REQUIRE(::pipe(pipes) == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  execution_context ctx(2);
+  std::optional<::io_uring_cqe> cqe;
+  completion c(ctx,
+               cqe);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_poll_add(&sqe,
+                             read.native_handle(),
+                             POLLIN);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  ctx.submit_detached([&](auto&& sqe,
+                          auto&&) noexcept
+                      {
+                        ::io_uring_prep_cancel64(&sqe,
+                                                 reinterpret_cast<std::uintptr_t>(&c),
+                                                 0);
+                      });
+  //  Only the cancelled operation is counted
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res == -ECANCELED);
+  //  Detached operations are not work
+  ctx.restart();
+  ctx.submit_detached([&](auto&& sqe,
+                          auto&&) noexcept
+                      {
+                        ::io_uring_prep_nop(&sqe);
+                      });
+  handlers = ctx.run();
+  CHECK(handlers == 0);
+}
+
+TEST_CASE("execution_context submit_detached parks when submission queue is full",
+          "[execution_context]")
+{
+  execution_context ctx(1);
+  std::vector<int> order;
+  ordered_completion a(ctx,
+                       order,
+                       1);
+  ordered_completion b(ctx,
+                       order,
+                       2);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &a);
+  ctx.get_executor().on_work_started();
+  ctx.submit_detached([&](auto&& sqe,
+                          auto&&) noexcept
+                      {
+                        ::io_uring_prep_nop(&sqe);
+                      });
+  CHECK(ctx.stats().parked == 1);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &b);
+  });
+  ctx.submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 2);
+  CHECK(order == std::vector<int>{1, 2});
+}
+
+TEST_CASE("execution_context submission_batch",
+          "[execution_context]")
+{
+  execution_context ctx(2);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  std::vector<counting_completion> cs(4,
+                                      c);
+  auto submit = [&](auto&& c) {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &c);
+    });
+  };
+  {
+    execution_context::submission_batch outer(ctx);
+    {
+      execution_context::submission_batch inner(ctx);
+      submit(cs[0]);
+    }
+    submit(cs[1]);
+    CHECK(::io_uring_sq_ready(ctx.native_handle()) == 2);
+    //  The submission queue is full so entries are
+    //  submitted early rather than parked
+    submit(cs[2]);
+    submit(cs[3]);
+    CHECK(ctx.stats().parked == 0);
+    CHECK(::io_uring_sq_ready(ctx.native_handle()) == 2);
+  }
+  CHECK(::io_uring_sq_ready(ctx.native_handle()) == 0);
+  auto handlers = ctx.run();
+  CHECK(handlers == 4);
+  CHECK(count == 4);
+}
+
+TEST_CASE("execution_context submit parked within handler",
+          "[execution_context]")
+{
+  execution_context ctx(2);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  std::vector<counting_completion> cs(16,
+                                      c);
+  auto func = [&]() {
+    for (auto&& c : cs) {
+      ctx.get_executor().on_work_started();
+      ctx.submit([&](auto&& sqe) noexcept {
+        ::io_uring_prep_nop(&sqe);
+        ::io_uring_sqe_set_data(&sqe,
+                                &c);
+      });
+    }
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  auto handlers = ctx.run();
+  CHECK(handlers == 17);
+  CHECK(count == 16);
+}
+
+TEST_CASE("execution_context completion queue overflow",
+          "[execution_context]")
+{
+  execution_context ctx(4);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  auto cq_entries = ctx.native_handle()->cq.ring_entries;
+  for (std::size_t i = 0; i < (cq_entries * 3); ++i) {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &c);
+    });
+  }
+  REQUIRE(::io_uring_cq_has_overflow(ctx.native_handle()));
+  auto handlers = ctx.poll();
+  CHECK(handlers == (cq_entries * 3));
+  CHECK(count == (cq_entries * 3));
+  auto stats = ctx.stats();
+  CHECK(stats.cq_overflows != 0);
+  CHECK(stats.cq_dropped == 0);
+  CHECK(stats.parked == 0);
+}
+
+TEST_CASE("execution_context completion queue overflow throttle",
+          "[execution_context]")
+{
+  execution_context ctx(4);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  std::vector<counting_completion> cs(8,
+                                      c);
+  auto cq_entries = ctx.native_handle()->cq.ring_entries;
+  for (std::size_t i = 0; i < (cq_entries * 2); ++i) {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &c);
+    });
+  }
+  REQUIRE(::io_uring_cq_has_overflow(ctx.native_handle()));
+  ctx.set_throttle_on_overflow(true);
+  for (auto&& c : cs) {
+    ctx.get_executor().on_work_started();
+    ctx.submit([&](auto&& sqe) noexcept {
+      ::io_uring_prep_nop(&sqe);
+      ::io_uring_sqe_set_data(&sqe,
+                              &c);
+    });
+  }
+  CHECK(ctx.stats().parked == cs.size());
+  auto handlers = ctx.run();
+  CHECK(handlers == ((cq_entries * 2) + cs.size()));
+  CHECK(count == ((cq_entries * 2) + cs.size()));
+  CHECK(ctx.stats().cq_overflows != 0);
+}
+
+TEST_CASE("execution_context register_buffers",
+          "[execution_context]")
+{
+  int pipes[2];
+  REQUIRE(::pipe(pipes) == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  char buffers[2][4] = {};
+  ::iovec iov;
+  iov.iov_base = buffers[0];
+  iov.iov_len = sizeof(buffers[0]);
+  execution_context ctx(100);
+  ctx.register_buffers(2);
+  ctx.update_buffers(1,
+                     &iov,
+                     1);
+  REQUIRE(::write(write.native_handle(),
+                  "abcd",
+                  4) == 4);
+  std::optional<::io_uring_cqe> cqe;
+  completion c(ctx,
+               cqe);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_read_fixed(&sqe,
+                               read.native_handle(),
+                               buffers[0],
+                               sizeof(buffers[0]),
+                               0,
+                               1);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res == 4);
+  CHECK(std::string_view(buffers[0],
+                         4) == "abcd");
+  ctx.unregister_buffers();
+  CHECK_THROWS_AS(ctx.unregister_buffers(),
+                  std::system_error);
+}
+
+TEST_CASE("execution_context opcode_supported",
+          "[execution_context]")
+{
+  execution_context ctx(10);
+  CHECK(ctx.opcode_supported(IORING_OP_NOP));
+  CHECK(ctx.opcode_supported(IORING_OP_READV));
+  CHECK_FALSE(ctx.opcode_supported(-1));
+  CHECK_FALSE(ctx.opcode_supported(1000));
+}
+
+TEST_CASE("execution_context register_file",
+          "[execution_context]")
+{
+  int pipes[2];
+  REQUIRE(::pipe(pipes) == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  execution_context ctx(100);
+  int index = ctx.register_file(write.native_handle());
+  CHECK(index >= 3);
+  char str[] = "abcd";
+  ::iovec iov;
+  iov.iov_base = str;
+  iov.iov_len = 4;
+  std::optional<::io_uring_cqe> cqe;
+  completion c(ctx,
+               cqe);
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_writev(&sqe,
+                           index,
+                           &iov,
+                           1,
+                           0);
+    sqe.flags |= IOSQE_FIXED_FILE;
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res == 4);
+  char buffer[4];
+  REQUIRE(::read(read.native_handle(),
+                 buffer,
+                 sizeof(buffer)) == 4);
+  CHECK(std::string_view(buffer,
+                         4) == "abcd");
+  int other = ctx.register_file(read.native_handle());
+  CHECK(other != index);
+  ctx.unregister_file(index);
+  CHECK(ctx.register_file(write.native_handle()) == index);
+}
+
 TEST_CASE("execution_context executor_type on_work_finished within handler",
           "[execution_context]")
 {
@@ -539,5 +1388,245 @@ TEST_CASE("execution_context executor_type on_work_started/_finished multiple ru
   CHECK(count == 1);
 }
 
+TEST_CASE("execution_context params",
+          "[execution_context]")
+{
+  ::io_uring_params params;
+  std::memset(&params,
+              0,
+              sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 256;
+  execution_context ctx(8,
+                        params);
+  CHECK(params.cq_entries == 256);
+  CHECK(ctx.native_handle()->cq.ring_entries == 256);
+  std::size_t count = 0;
+  counting_completion c(ctx,
+                        count);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &c);
+  ctx.get_executor().on_work_started();
+  ctx.submit();
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+}
+
+TEST_CASE("execution_context params defer taskrun",
+          "[execution_context]")
+{
+  ::io_uring_params params;
+  std::memset(&params,
+              0,
+              sizeof(params));
+  params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+  std::optional<execution_context> ctx;
+  try {
+    ctx.emplace(8,
+                params);
+  } catch (const std::system_error& ex) {
+    //  Kernel predates IORING_SETUP_DEFER_TASKRUN
+    REQUIRE(ex.code() == std::errc::invalid_argument);
+    return;
+  }
+  std::size_t count = 0;
+  counting_completion c(*ctx,
+                        count);
+  auto&& sqe = ctx->get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          &c);
+  ctx->get_executor().on_work_started();
+  ctx->submit();
+  auto handlers = ctx->poll();
+  CHECK(handlers == 1);
+  CHECK(count == 1);
+}
+
+TEST_CASE("execution_context params single issuer concurrent",
+          "[execution_context]")
+{
+  ::io_uring_params params;
+  std::memset(&params,
+              0,
+              sizeof(params));
+  params.flags = IORING_SETUP_SINGLE_ISSUER;
+  std::optional<std::error_code> ec;
+  try {
+    execution_context ctx(8,
+                          params,
+                          2);
+  } catch (const std::system_error& ex) {
+    ec = ex.code();
+  }
+  REQUIRE(ec);
+  CHECK(*ec == std::errc::invalid_argument);
+}
+
+TEST_CASE("execution_context concurrent",
+          "[execution_context]")
+{
+  execution_context a(100);
+  CHECK_FALSE(a.concurrent());
+  execution_context b(100,
+                      0,
+                      4);
+  CHECK(b.concurrent());
+}
+
+TEST_CASE("execution_context concurrent run",
+          "[execution_context]")
+{
+  execution_context ctx(100,
+                        0,
+                        4);
+  constexpr std::size_t threads = 4;
+  constexpr std::size_t posts = 10000;
+  std::atomic<std::size_t> invoked(0);
+  std::atomic<std::size_t> outside(0);
+  for (std::size_t i = 0; i < posts; ++i) {
+    boost::asio::post(ctx.get_executor(),
+                      [&]() { if (!ctx.running_in_this_thread()) {
+                                ++outside;
+                              }
+                              ++invoked; });
+  }
+  std::atomic<std::size_t> handlers(0);
+  std::vector<std::thread> ts;
+  for (std::size_t i = 0; i < threads; ++i) {
+    ts.emplace_back([&]() { handlers += ctx.run(); });
+  }
+  for (auto&& t : ts) {
+    t.join();
+  }
+  CHECK(handlers == posts);
+  CHECK(invoked == posts);
+  CHECK(outside == 0);
+  CHECK_FALSE(ctx.running_in_this_thread());
+}
+
+TEST_CASE("execution_context concurrent handlers run in parallel",
+          "[execution_context]")
+{
+  execution_context ctx(100,
+                        0,
+                        2);
+  std::atomic<std::size_t> started(0);
+  std::atomic<std::size_t> overlapped(0);
+  auto func = [&]() {
+    CHECK(ctx.running_in_this_thread());
+    ++started;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((started != 2) && (std::chrono::steady_clock::now() < deadline)) {
+      std::this_thread::yield();
+    }
+    if (started == 2) {
+      ++overlapped;
+    }
+  };
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  boost::asio::post(ctx.get_executor(),
+                    func);
+  std::thread t([&]() { ctx.run(); });
+  ctx.run();
+  t.join();
+  CHECK(overlapped == 2);
+}
+
+class atomic_counting_completion : public execution_context::completion {
+public:
+  atomic_counting_completion(execution_context& ctx,
+                             std::atomic<std::size_t>& count) noexcept
+    : ctx_  (ctx),
+      count_(count)
+  {}
+  virtual void complete(const ::io_uring_cqe&) override {
+    ++count_;
+    ctx_.get_executor().on_work_finished();
+  }
+private:
+  execution_context&        ctx_;
+  std::atomic<std::size_t>& count_;
+};
+
+TEST_CASE("execution_context concurrent completions",
+          "[execution_context]")
+{
+  execution_context ctx(64,
+                        0,
+                        4);
+  constexpr std::size_t threads = 4;
+  constexpr std::size_t per_thread = 2000;
+  std::atomic<std::size_t> count(0);
+  std::atomic<std::size_t> submitted(0);
+  atomic_counting_completion c(ctx,
+                               count);
+  ctx.get_executor().on_work_started();
+  std::atomic<std::size_t> remaining(threads);
+  std::atomic<std::size_t> handlers(0);
+  std::vector<std::thread> ts;
+  for (std::size_t i = 0; i < threads; ++i) {
+    ts.emplace_back([&]() {
+      std::thread submitter([&]() {
+        for (std::size_t j = 0; j < per_thread; ++j) {
+          ctx.get_executor().on_work_started();
+          ++submitted;
+          ctx.submit([&](auto&& sqe) noexcept {
+            ::io_uring_prep_nop(&sqe);
+            ::io_uring_sqe_set_data(&sqe,
+                                    &c);
+          });
+          //  Keep the number of outstanding operations
+          //  below the size of the completion queue
+          while ((submitted - count) > 32) {
+            std::this_thread::yield();
+          }
+        }
+        if (!--remaining) {
+          ctx.get_executor().on_work_finished();
+        }
+      });
+      handlers += ctx.run();
+      submitter.join();
+    });
+  }
+  for (auto&& t : ts) {
+    t.join();
+  }
+  CHECK(count == (threads * per_thread));
+  CHECK(handlers == (threads * per_thread));
+}
+
+TEST_CASE("execution_context concurrent stop",
+          "[execution_context]")
+{
+  execution_context ctx(100,
+                        0,
+                        4);
+  constexpr std::size_t threads = 4;
+  ctx.get_executor().on_work_started();
+  std::vector<std::thread> ts;
+  for (std::size_t i = 0; i < threads; ++i) {
+    ts.emplace_back([&]() { ctx.run(); });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ctx.stop();
+  for (auto&& t : ts) {
+    t.join();
+  }
+  bool invoked = false;
+  boost::asio::post(ctx.get_executor(),
+                    [&]() { invoked = true;
+                            ctx.get_executor().on_work_finished(); });
+  ctx.restart();
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  CHECK(invoked);
+}
+
 }
 }
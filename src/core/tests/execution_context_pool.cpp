@@ -0,0 +1,178 @@
+#include <asio_uring/execution_context_pool.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <asio_uring/execution_context.hpp>
+#include <boost/asio/post.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::tests {
+namespace {
+
+static_assert(!std::is_default_constructible_v<execution_context_pool>);
+static_assert(!std::is_move_constructible_v<execution_context_pool>);
+static_assert(!std::is_move_assignable_v<execution_context_pool>);
+static_assert(!std::is_copy_constructible_v<execution_context_pool>);
+static_assert(!std::is_copy_assignable_v<execution_context_pool>);
+
+TEST_CASE("execution_context_pool",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(3,
+                              10);
+  REQUIRE(pool.size() == 3);
+  std::set<const execution_context*> contexts;
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    contexts.insert(&pool.context(i));
+  }
+  CHECK(contexts.size() == 3);
+}
+
+TEST_CASE("execution_context_pool empty",
+          "[execution_context_pool]")
+{
+  std::optional<execution_context_pool> pool;
+  CHECK_THROWS_AS(pool.emplace(0,
+                               10),
+                  std::system_error);
+}
+
+TEST_CASE("execution_context_pool round robin",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(3,
+                              10);
+  std::vector<const execution_context*> selected;
+  for (std::size_t i = 0; i < 6; ++i) {
+    selected.push_back(&pool.get_executor().context());
+  }
+  CHECK(selected[0] != selected[1]);
+  CHECK(selected[1] != selected[2]);
+  CHECK(selected[0] != selected[2]);
+  CHECK(selected[0] == selected[3]);
+  CHECK(selected[1] == selected[4]);
+  CHECK(selected[2] == selected[5]);
+}
+
+TEST_CASE("execution_context_pool least loaded",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(3,
+                              10,
+                              0,
+                              load_balancing::least_loaded);
+  pool.context(0).get_executor().on_work_started();
+  pool.context(2).get_executor().on_work_started();
+  pool.context(2).get_executor().on_work_started();
+  for (std::size_t i = 0; i < 3; ++i) {
+    CHECK(&pool.get_executor().context() == &pool.context(1));
+  }
+  pool.context(1).get_executor().on_work_started();
+  pool.context(1).get_executor().on_work_started();
+  CHECK(&pool.get_executor().context() == &pool.context(0));
+  pool.context(0).get_executor().on_work_finished();
+  pool.context(1).get_executor().on_work_finished();
+  pool.context(1).get_executor().on_work_finished();
+  pool.context(2).get_executor().on_work_finished();
+  pool.context(2).get_executor().on_work_finished();
+}
+
+TEST_CASE("execution_context_pool run",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(4,
+                              10);
+  constexpr std::size_t posts = 100;
+  std::atomic<std::size_t> invoked(0);
+  std::atomic<std::size_t> outside(0);
+  std::mutex m;
+  std::set<std::thread::id> threads;
+  for (std::size_t i = 0; i < posts; ++i) {
+    auto ex = pool.get_executor();
+    boost::asio::post(ex,
+                      [&, ex]() { if (!ex.context().running_in_this_thread()) {
+                                    ++outside;
+                                  }
+                                  {
+                                    std::lock_guard<std::mutex> l(m);
+                                    threads.insert(std::this_thread::get_id());
+                                  }
+                                  ++invoked; });
+  }
+  auto handlers = pool.run();
+  CHECK(handlers == posts);
+  CHECK(invoked == posts);
+  CHECK(outside == 0);
+  CHECK(threads.size() == 4);
+  CHECK(threads.count(std::this_thread::get_id()) == 0);
+}
+
+TEST_CASE("execution_context_pool pin",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(2,
+                              10);
+  std::atomic<std::size_t> pinned(0);
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    boost::asio::post(pool.context(i).get_executor(),
+                      [&]() { ::cpu_set_t set;
+                              CPU_ZERO(&set);
+                              if (!::pthread_getaffinity_np(::pthread_self(),
+                                                            sizeof(set),
+                                                            &set) &&
+                                  (CPU_COUNT(&set) == 1))
+                              {
+                                ++pinned;
+                              } });
+  }
+  pool.run();
+  CHECK(pinned == 2);
+}
+
+TEST_CASE("execution_context_pool stop",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(2,
+                              10);
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    pool.context(i).get_executor().on_work_started();
+  }
+  std::optional<execution_context_pool::count_type> handlers;
+  std::thread t([&]() { handlers = pool.run(); });
+  pool.stop();
+  t.join();
+  REQUIRE(handlers);
+  CHECK(*handlers == 0);
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    pool.context(i).get_executor().on_work_finished();
+  }
+  pool.restart();
+  CHECK(pool.run() == 0);
+}
+
+TEST_CASE("execution_context_pool exception",
+          "[execution_context_pool]")
+{
+  execution_context_pool pool(2,
+                              10);
+  pool.context(1).get_executor().on_work_started();
+  boost::asio::post(pool.context(0).get_executor(),
+                    []() { throw std::runtime_error("Test"); });
+  CHECK_THROWS_AS(pool.run(),
+                  std::runtime_error);
+  pool.context(1).get_executor().on_work_finished();
+}
+
+}
+}
@@ -0,0 +1,101 @@
+#include <asio_uring/local_queue.hpp>
+
+#include <stdexcept>
+#include <vector>
+#include <asio_uring/test/allocator.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::tests {
+namespace {
+
+TEST_CASE("local_queue emplace & consume_one",
+          "[local_queue]")
+{
+  using allocator_type = test::allocator<int>;
+  allocator_type::state_type s;
+  allocator_type a(s);
+  std::vector<int> consumed;
+  {
+    local_queue<int,
+                allocator_type> queue(a);
+    CHECK(queue.empty());
+    CHECK(queue.size() == 0);
+    queue.emplace(1);
+    queue.push(2);
+    CHECK_FALSE(queue.empty());
+    CHECK(queue.size() == 2);
+    CHECK(s.allocate == 2);
+    CHECK(s.construct == 2);
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
+    CHECK(queue.size() == 1);
+    queue.emplace(3);
+    CHECK(queue.size() == 2);
+    CHECK(s.allocate == 2);
+    CHECK(s.construct == 2);
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
+    CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
+    CHECK_FALSE(queue.consume_one([&](auto i) { consumed.push_back(i); }));
+    CHECK(queue.empty());
+    CHECK(queue.size() == 0);
+    REQUIRE(consumed.size() == 3);
+    CHECK(consumed[0] == 1);
+    CHECK(consumed[1] == 2);
+    CHECK(consumed[2] == 3);
+    queue.emplace(4);
+  }
+  CHECK(s.allocate == 2);
+  CHECK(s.construct == 2);
+  CHECK(s.deallocate == 2);
+  CHECK(s.destroy == 2);
+}
+
+TEST_CASE("local_queue burst",
+          "[local_queue]")
+{
+  using allocator_type = test::allocator<int>;
+  allocator_type::state_type s;
+  allocator_type a(s);
+  constexpr std::size_t n = 1000;
+  {
+    local_queue<int,
+                allocator_type> queue(a);
+    for (std::size_t i = 0; i < n; ++i) {
+      queue.emplace(int(i));
+    }
+    CHECK(s.allocate == n);
+    std::size_t consumed = 0;
+    while (queue.consume_one([&](auto) { ++consumed; }));
+    CHECK(consumed == n);
+    //  Only a bounded number of nodes is retained
+    CHECK(s.deallocate == (n - 128));
+    for (std::size_t i = 0; i < 128; ++i) {
+      queue.emplace(int(i));
+    }
+    CHECK(s.allocate == n);
+  }
+  CHECK(s.deallocate == n);
+}
+
+TEST_CASE("local_queue exception",
+          "[local_queue]")
+{
+  std::vector<int> consumed;
+  local_queue<int> queue;
+  queue.emplace(1);
+  queue.emplace(2);
+  auto func = [&](auto i) {
+    consumed.push_back(i);
+    throw std::runtime_error("foo");
+  };
+  CHECK_THROWS_AS(queue.consume_one(func),
+                  std::runtime_error);
+  CHECK(queue.size() == 1);
+  CHECK(queue.consume_one([&](auto i) { consumed.push_back(i); }));
+  REQUIRE(consumed.size() == 2);
+  CHECK(consumed[0] == 1);
+  CHECK(consumed[1] == 2);
+}
+
+}
+}
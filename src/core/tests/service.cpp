@@ -1,14 +1,19 @@
 #include <asio_uring/service.hpp>
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
+#include <asio_uring/config.hpp>
 #include <asio_uring/execution_context.hpp>
 #include <asio_uring/fd.hpp>
 #include <asio_uring/liburing.hpp>
+#include <asio_uring/test/allocator.hpp>
 #include <boost/core/noncopyable.hpp>
+#include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
 #include <stdlib.h>
@@ -150,12 +155,116 @@ TEST_CASE("service poll add/remove",
   handlers = ctx.run();
   CHECK(handlers == 2);
   REQUIRE(add_cqe);
-  CHECK(add_cqe->res == 0);
+  CHECK((add_cqe->res == 0 || add_cqe->res == -ECANCELED));
   REQUIRE(remove_cqe);
   CHECK(remove_cqe->res == 0);
   CHECK(impl.begin() == impl.end());
 }
 
+TEST_CASE("service multishot",
+          "[service]")
+{
+  int pipes[2];
+  auto result = ::pipe(pipes);
+  CHECK(result == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  void* user_data = nullptr;
+  std::vector<::io_uring_cqe> cqes;
+  std::optional<::io_uring_cqe> remove_cqe;
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::allocator<void> a;
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto data) noexcept
+               {
+                 ::io_uring_prep_poll_multishot(&sqe,
+                                                read.native_handle(),
+                                                POLLIN);
+                 user_data = data;
+               },
+               [&](auto c) { cqes.push_back(c); },
+               a);
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  char c = 'A';
+  for (std::size_t i = 1; i <= 2; ++i) {
+    REQUIRE(::write(write.native_handle(),
+                    &c,
+                    sizeof(c)) == 1);
+    ctx.restart();
+    handlers = ctx.run_one();
+    CHECK(handlers == 1);
+    REQUIRE(cqes.size() == i);
+    CHECK((cqes.back().flags & IORING_CQE_F_MORE) != 0);
+    CHECK(std::distance(impl.begin(),
+                        impl.end()) == 1);
+  }
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_poll_remove(&sqe,
+                                             user_data);
+               },
+               [&](auto c) { remove_cqe = c; },
+               a);
+  ctx.restart();
+  handlers = ctx.run();
+  CHECK(handlers == 2);
+  REQUIRE(remove_cqe);
+  CHECK(remove_cqe->res == 0);
+  REQUIRE(cqes.size() == 3);
+  CHECK(cqes.back().res == -ECANCELED);
+  CHECK((cqes.back().flags & IORING_CQE_F_MORE) == 0);
+  CHECK(impl.begin() == impl.end());
+}
+
+TEST_CASE("service initiate w/timeout",
+          "[service]")
+{
+  int pipes[2];
+  auto result = ::pipe(pipes);
+  CHECK(result == 0);
+  fd read(pipes[0]);
+  fd write(pipes[1]);
+  std::optional<::io_uring_cqe> cqe;
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::allocator<void> a;
+  ::__kernel_timespec ts{};
+  ts.tv_nsec = 10000000;
+  svc.initiate(impl,
+               0,
+               ts,
+               [&](auto&& sqe,
+                   auto,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_poll_add(&sqe,
+                                          read.native_handle(),
+                                          POLLIN);
+               },
+               [&](auto c) { cqe = c; },
+               a);
+  //  The timeout is copied
+  ts.tv_sec = 10;
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  CHECK(cqe->res == -ETIME);
+  CHECK(impl.begin() == impl.end());
+}
+
 TEST_CASE("service move_construct",
           "[service]")
 {
@@ -315,6 +424,239 @@ TEST_CASE("service initiate w/iovs",
   CHECK_FALSE(cqe);
 }
 
+TEST_CASE("service initiate w/many iovs",
+          "[service]")
+{
+  std::string str("abcdefghijklmnop");
+  char filename[] = "/tmp/XXXXXX";
+  fd file(::mkstemp(filename));
+  INFO("Temporary file is " << filename);
+  auto written = ::write(file.native_handle(),
+                         str.data(),
+                         str.size());
+  REQUIRE(written == str.size());
+  file = fd();
+  file = fd(::open(filename,
+                   O_RDONLY));
+  char buffer[16];
+  std::optional<::io_uring_cqe> cqe;
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::allocator<void> a;
+  svc.initiate(impl,
+               sizeof(buffer),
+               [&](auto&& sqe,
+                   auto* iovs,
+                   auto) noexcept
+               {
+                 for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+                   iovs[i].iov_base = &buffer[i];
+                   iovs[i].iov_len = 1;
+                 }
+                 ::io_uring_prep_readv(&sqe,
+                                       file.native_handle(),
+                                       iovs,
+                                       sizeof(buffer),
+                                       0);
+               },
+               [&](auto&& c) { cqe = c; },
+               a);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  REQUIRE(cqe->res == 16);
+  CHECK(std::equal(std::begin(buffer),
+                   std::end(buffer),
+                   str.begin(),
+                   str.end()));
+}
+
+TEST_CASE("service initiate large handler",
+          "[service]")
+{
+  std::optional<::io_uring_cqe> cqe;
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  using allocator_type = test::allocator<void>;
+  allocator_type::state_type as;
+  allocator_type a(as);
+  std::optional<std::size_t> deallocated;
+  char arr[1024] = {};
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_nop(&sqe);
+               },
+               [&, arr](auto c) {
+                 deallocated = as.deallocate.load();
+                 cqe = c;
+                 (void)arr;
+               },
+               a);
+  CHECK(as.allocate == 1);
+  CHECK(as.deallocate == 0);
+  auto handlers = ctx.run();
+  CHECK(handlers == 1);
+  REQUIRE(cqe);
+  REQUIRE(deallocated);
+  CHECK(*deallocated == 1);
+  CHECK(as.allocate == 1);
+  CHECK(as.deallocate == 1);
+  CHECK(as.construct == as.destroy);
+}
+
+TEST_CASE("service initiate large handler shutdown",
+          "[service]")
+{
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  using allocator_type = test::allocator<void>;
+  allocator_type::state_type as;
+  allocator_type a(as);
+  bool invoked = false;
+  char arr[1024] = {};
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_nop(&sqe);
+               },
+               [&, arr](auto) {
+                 invoked = true;
+                 (void)arr;
+               },
+               a);
+  CHECK(as.allocate == 1);
+  svc.shutdown();
+  CHECK(as.deallocate == 1);
+  CHECK_FALSE(invoked);
+}
+
+TEST_CASE("service shutdown parked",
+          "[service]")
+{
+  execution_context ctx(1);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  auto&& sqe = ctx.get_sqe();
+  ::io_uring_prep_nop(&sqe);
+  ::io_uring_sqe_set_data(&sqe,
+                          nullptr);
+  std::allocator<void> a;
+  bool invoked = false;
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_nop(&sqe);
+               },
+               [&](auto) { invoked = true; },
+               a);
+  CHECK(ctx.stats().parked == 1);
+  CHECK(ctx.outstanding_work() == 1);
+  CHECK(std::distance(impl.begin(),
+                      impl.end()) == 1);
+  svc.shutdown();
+  //  The parked operation is never submitted and its
+  //  completion object is released immediately
+  CHECK(ctx.outstanding_work() == 0);
+  CHECK(impl.begin() == impl.end());
+  ctx.submit();
+  auto handlers = ctx.poll();
+  CHECK(handlers == 0);
+  CHECK_FALSE(invoked);
+}
+
+TEST_CASE("service shutdown then complete",
+          "[service]")
+{
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::allocator<void> a;
+  bool invoked = false;
+  svc.initiate(impl,
+               [&](auto&& sqe,
+                   auto) noexcept
+               {
+                 ::io_uring_prep_nop(&sqe);
+               },
+               [&](auto) { invoked = true; },
+               a);
+  svc.shutdown();
+  CHECK(ctx.outstanding_work() == 0);
+  CHECK(std::distance(impl.begin(),
+                      impl.end()) == 1);
+  //  The operation no longer counts as work so the
+  //  execution context must be kept running for it
+  ctx.get_executor().on_work_started();
+  auto handlers = ctx.poll();
+  ctx.get_executor().on_work_finished();
+  CHECK(handlers == 1);
+  CHECK_FALSE(invoked);
+  CHECK(impl.begin() == impl.end());
+}
+
+TEST_CASE("service size classes",
+          "[service]")
+{
+  execution_context ctx(100);
+  service svc(ctx);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  using allocator_type = test::allocator<void>;
+  allocator_type::state_type as;
+  allocator_type a(as);
+  std::size_t count = 0;
+  auto initiate = [&](auto h) {
+    svc.initiate(impl,
+                 [&](auto&& sqe,
+                     auto) noexcept
+                 {
+                   ::io_uring_prep_nop(&sqe);
+                 },
+                 std::move(h),
+                 a);
+  };
+  initiate([&](auto) { ++count; });
+  auto small = svc.capacity();
+  CHECK(small != 0);
+  initiate([&](auto) { ++count; });
+  CHECK(svc.capacity() == small);
+  char arr[config::completion_storage_size * 2] = {};
+  initiate([&, arr](auto) {
+    ++count;
+    (void)arr;
+  });
+  CHECK(svc.capacity() == (small * 2));
+  CHECK(as.allocate == 0);
+  auto handlers = ctx.run();
+  CHECK(handlers == 3);
+  CHECK(count == 3);
+  CHECK(as.allocate == 0);
+}
+
 TEST_CASE("service shutdown idempotence",
           "[service]")
 {
@@ -345,5 +687,67 @@ TEST_CASE("service shutdown idempotence",
   svc.shutdown();
 }
 
+TEST_CASE("service prewarm",
+          "[service]")
+{
+  execution_context ctx(100);
+  service svc(ctx,
+              100);
+  auto capacity = svc.capacity();
+  CHECK(capacity >= 100);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::size_t count = 0;
+  std::allocator<void> a;
+  for (std::size_t i = 0; i < 100; ++i) {
+    svc.initiate(impl,
+                 [&](auto&& sqe,
+                     auto) noexcept
+                 {
+                   ::io_uring_prep_nop(&sqe);
+                 },
+                 [&](auto) { ++count; },
+                 a);
+  }
+  CHECK(svc.capacity() == capacity);
+  auto handlers = ctx.run();
+  CHECK(handlers == 100);
+  CHECK(count == 100);
+  CHECK(svc.capacity() == capacity);
+}
+
+TEST_CASE("service high water mark",
+          "[service]")
+{
+  execution_context ctx(100);
+  service svc(ctx,
+              0,
+              0);
+  CHECK(svc.capacity() == 0);
+  service::implementation_type impl;
+  svc.construct(impl);
+  guard g(svc,
+          impl);
+  std::size_t count = 0;
+  std::allocator<void> a;
+  for (std::size_t i = 0; i < 50; ++i) {
+    svc.initiate(impl,
+                 [&](auto&& sqe,
+                     auto) noexcept
+                 {
+                   ::io_uring_prep_nop(&sqe);
+                 },
+                 [&](auto) { ++count; },
+                 a);
+  }
+  CHECK(svc.capacity() >= 50);
+  auto handlers = ctx.run();
+  CHECK(handlers == 50);
+  CHECK(count == 50);
+  CHECK(svc.capacity() == 0);
+}
+
 }
 }
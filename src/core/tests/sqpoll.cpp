@@ -0,0 +1,141 @@
+#include <asio_uring/sqpoll.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <asio_uring/execution_context.hpp>
+#include <asio_uring/liburing.hpp>
+#include <asio_uring/uring.hpp>
+#include <boost/asio/post.hpp>
+#include <errno.h>
+
+#include <catch2/catch.hpp>
+
+namespace asio_uring::tests {
+namespace {
+
+class counting_completion : public execution_context::completion {
+public:
+  counting_completion(execution_context& ctx,
+                      std::size_t& count) noexcept
+    : ctx_  (ctx),
+      count_(count)
+  {}
+  virtual void complete(const ::io_uring_cqe& cqe) override {
+    CHECK(cqe.res == 0);
+    ctx_.get_executor().on_work_finished();
+    ++count_;
+  }
+private:
+  execution_context& ctx_;
+  std::size_t&       count_;
+};
+
+void nop(execution_context& ctx,
+         counting_completion& c)
+{
+  ctx.get_executor().on_work_started();
+  ctx.submit([&](auto&& sqe) noexcept {
+    ::io_uring_prep_nop(&sqe);
+    ::io_uring_sqe_set_data(&sqe,
+                            &c);
+  });
+}
+
+bool sqpoll_denied(const std::system_error& ex) {
+  return (ex.code() == std::errc::operation_not_permitted) ||
+         (ex.code() == std::errc::invalid_argument);
+}
+
+TEST_CASE("sqpoll_params",
+          "[sqpoll]")
+{
+  auto params = sqpoll_params(std::chrono::milliseconds(50));
+  CHECK(params.flags == IORING_SETUP_SQPOLL);
+  CHECK(params.sq_thread_idle == 50);
+  params = sqpoll_params(std::chrono::milliseconds(10),
+                         2);
+  CHECK(params.flags == (IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF));
+  CHECK(params.sq_thread_cpu == 2);
+  uring ring(1);
+  params = sqpoll_params(std::chrono::milliseconds(10),
+                         std::nullopt,
+                         ring.native_handle());
+  CHECK(params.flags == (IORING_SETUP_SQPOLL | IORING_SETUP_ATTACH_WQ));
+  CHECK(params.wq_fd == unsigned(ring.native_handle()->ring_fd));
+}
+
+TEST_CASE("sqpoll execution_context",
+          "[sqpoll][execution_context]")
+{
+  auto params = sqpoll_params(std::chrono::milliseconds(10));
+  std::optional<execution_context> ctx;
+  try {
+    ctx.emplace(4,
+                params);
+  } catch (const std::system_error& ex) {
+    REQUIRE(sqpoll_denied(ex));
+    return;
+  }
+  std::size_t count = 0;
+  counting_completion c(*ctx,
+                        count);
+  //  More operations than there are submission queue
+  //  entries
+  constexpr std::size_t ops = 16;
+  boost::asio::post(ctx->get_executor(),
+                    [&]() { for (std::size_t i = 0; i < ops; ++i) {
+                              nop(*ctx,
+                                  c);
+                            } });
+  auto handlers = ctx->run();
+  CHECK(handlers == (ops + 1));
+  CHECK(count == ops);
+  //  Let the kernel thread go to sleep so that the
+  //  next submission must wake it
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ctx->restart();
+  nop(*ctx,
+      c);
+  handlers = ctx->run();
+  CHECK(handlers == 1);
+  CHECK(count == (ops + 1));
+}
+
+TEST_CASE("sqpoll shared",
+          "[sqpoll][execution_context]")
+{
+  auto params = sqpoll_params(std::chrono::milliseconds(10));
+  std::optional<execution_context> a;
+  try {
+    a.emplace(4,
+              params);
+  } catch (const std::system_error& ex) {
+    REQUIRE(sqpoll_denied(ex));
+    return;
+  }
+  params = sqpoll_params(std::chrono::milliseconds(10),
+                         std::nullopt,
+                         a->native_handle());
+  execution_context b(4,
+                      params);
+  std::size_t a_count = 0;
+  std::size_t b_count = 0;
+  counting_completion a_c(*a,
+                          a_count);
+  counting_completion b_c(b,
+                          b_count);
+  nop(*a,
+      a_c);
+  nop(b,
+      b_c);
+  CHECK(a->run() == 1);
+  CHECK(b.run() == 1);
+  CHECK(a_count == 1);
+  CHECK(b_count == 1);
+}
+
+}
+}
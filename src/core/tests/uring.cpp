@@ -56,6 +56,46 @@ TEST_CASE("uring no entries",
   CHECK(&ec->category() == &std::generic_category());
 }
 
+TEST_CASE("uring params",
+          "[uring]")
+{
+  ::io_uring_params params;
+  std::memset(&params,
+              0,
+              sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 64;
+  uring ring(4,
+             params);
+  REQUIRE(ring.native_handle());
+  CHECK(ring.native_handle()->ring_fd != -1);
+  CHECK(params.sq_entries == 4);
+  CHECK(params.cq_entries == 64);
+  CHECK(ring.native_handle()->cq.ring_entries == 64);
+  CHECK(params.features != 0);
+  CHECK(ring.features() == params.features);
+}
+
+TEST_CASE("uring params error",
+          "[uring]")
+{
+  ::io_uring_params params;
+  std::memset(&params,
+              0,
+              sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 0;
+  std::optional<std::error_code> ec;
+  try {
+    uring ring(4,
+               params);
+  } catch (const std::system_error& ex) {
+    ec = ex.code();
+  }
+  REQUIRE(ec);
+  CHECK(*ec == std::errc::invalid_argument);
+}
+
 TEST_CASE("uring poll read",
           "[uring]")
 {
@@ -455,7 +495,7 @@ TEST_CASE("uring tcp socket poll read then remove",
   REQUIRE(result >= 0);
   REQUIRE(cqe);
   CHECK(::io_uring_cqe_get_data(cqe) == is);
-  CHECK(cqe->res == 0);
+  CHECK((cqe->res == 0 || cqe->res == -ECANCELED));
 }
 
 TEST_CASE("uring remove poll does not exist",
@@ -9,11 +9,26 @@ namespace asio_uring {
 uring::uring(unsigned entries,
              unsigned flags)
 {
-  if (::io_uring_queue_init(entries,
-                            &ring_,
-                            flags))
-  {
-    std::error_code ec(errno,
+  int result = ::io_uring_queue_init(entries,
+                                     &ring_,
+                                     flags);
+  if (result) {
+    //  Newer versions of liburing return the negated
+    //  error rather than setting errno
+    std::error_code ec((result < 0) ? -result : errno,
+                       std::generic_category());
+    throw std::system_error(ec);
+  }
+}
+
+uring::uring(unsigned entries,
+             ::io_uring_params& params)
+{
+  int result = ::io_uring_queue_init_params(entries,
+                                            &ring_,
+                                            &params);
+  if (result) {
+    std::error_code ec((result < 0) ? -result : errno,
                        std::generic_category());
     throw std::system_error(ec);
   }
@@ -31,4 +46,8 @@ uring::const_native_handle_type uring::native_handle() const noexcept {
   return &ring_;
 }
 
+unsigned uring::features() const noexcept {
+  return ring_.features;
+}
+
 }